@@ -94,11 +94,16 @@ void OrchestraSynthApplication::anotherInstanceStarted (const juce::String&)
 {
 }
 
-void OrchestraSynthApplication::initialise (const juce::String&)
+void OrchestraSynthApplication::initialise (const juce::String& commandLine)
 {
     logger.log (Logger::LogLevel::Info, "OrchestraSynth starting up");
     crashReporter.installGlobalHandler();
-    perfMon.beginSession();
+
+    // --trace <file>: capture a Chrome/Perfetto trace of the whole session, written on quit
+    const juce::ArgumentList args ("OrchestraSynth", commandLine);
+    perfMon.beginSession (args.containsOption ("--trace")
+                              ? juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--trace"))
+                              : juce::File());
 
     if (! validatePlatformSupport())
     {
@@ -1,81 +1,704 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <array>
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "ImpulseResponseDiskCache.h"
+#include "ImpulseResponseLoader.h"
+#include "NonUniformConvolver.h"
 #include "../Systems/Logger.h"
+#include "../Systems/SharedResourceCache.h"
 
+// Convolution reverb with background IR preparation.
+//
+// loadImpulseResponse() only queues the request. A dedicated loader thread
+// decodes the file, resamples it to the session rate, trims trailing
+// silence, normalises it to unit energy, partitions/FFTs it and builds a
+// complete NonUniformConvolver. That convolver is published through an
+// atomic pointer; the audio thread adopts it at the start of a block and
+// crossfades from the old one over crossfadeSeconds, so switching halls
+// mid-performance is click-free and the audio thread never allocates or
+// frees anything. Convolvers the audio thread is done with go back through a
+// second atomic slot and are destroyed on the loader thread.
+//
+// Only one swap is in flight at a time: the audio thread adopts a new
+// convolver only once the previous retired one has been collected.
+//
+// IRs loaded from files go through the process-wide SharedResourceCache:
+// every instance using the same file shares one decoded buffer, and every
+// instance at the same rate/block size shares one set of partition spectra.
+// Only the per-instance convolution state is private. Spectra are also
+// persisted by ImpulseResponseDiskCache, so a reopened session maps them
+// instead of decoding the file again.
+//
+// process() adds the wet signal (scaled by the wet level) of its input to
+// the output buffer, either in place or from a separate send bus. Until an
+// IR has been loaded, the output is left untouched.
 class ConvolutionEngine
 {
 public:
-    explicit ConvolutionEngine (Logger& loggerIn) : logger (loggerIn) {}
+    static constexpr double crossfadeSeconds = 0.05;
+
+    explicit ConvolutionEngine (Logger& loggerIn) : logger (loggerIn), loaderThread (*this) {}
+
+    ~ConvolutionEngine()
+    {
+        loaderThread.stopThread (4000);
+        releaseConvolvers();
+    }
 
     ConvolutionEngine (const ConvolutionEngine&) = delete;
     ConvolutionEngine& operator= (const ConvolutionEngine&) = delete;
     ConvolutionEngine (ConvolutionEngine&&) = delete;
     ConvolutionEngine& operator= (ConvolutionEngine&&) = delete;
 
+    // Message thread, audio stopped. Drops the current convolver and rebuilds
+    // the last loaded IR for the new rate/block size in the background.
     void prepare (const juce::dsp::ProcessSpec& spec)
     {
-        juce::dsp::ProcessSpec s = spec;
-        convolution.prepare (s);
+        prepared.store (false, std::memory_order_release);
+
+        {
+            const std::lock_guard<std::mutex> lock (sessionLock);
+            session.sampleRate = spec.sampleRate;
+            session.maxBlockSize = juce::jmax (1, (int) spec.maximumBlockSize);
+            session.numChannels = juce::jlimit (1, 2, (int) spec.numChannels);
+            ++session.generation;
+
+            releaseConvolvers();
+        }
+
+        wetCurrent.setSize (session.numChannels, session.maxBlockSize);
+        wetFading.setSize (session.numChannels, session.maxBlockSize);
+        crossfadeSamples = juce::jmax (1, (int) (crossfadeSeconds * spec.sampleRate));
+        statsSampleRate.store (spec.sampleRate, std::memory_order_relaxed);
+        wetGain.reset (spec.sampleRate, crossfadeSeconds);
+        wetGain.setCurrentAndTargetValue (wetLevel.load (std::memory_order_relaxed));
+
+        silentSamples = 0;
+        bypassed = false;
+
+        {
+            const std::lock_guard<std::mutex> lock (requestLock);
+            rebuildRequested = true;
+        }
+
+        if (! loaderThread.isThreadRunning())
+            loaderThread.startThread (juce::Thread::Priority::low);
+
+        loaderThread.notify();
         prepared.store (true, std::memory_order_release);
     }
 
+    // Clears the reverb tail; the loaded IR is kept.
     void reset()
     {
-        convolution.reset();
+        if (current != nullptr)
+            current->reset();
+
+        finishCrossfade();
+        silentSamples = 0;
+        bypassed = false;
     }
 
+    // Any thread. Offline rendering waits for late background tail blocks;
+    // in real time they are dropped and counted (see NonUniformConvolver).
+    void setNonRealtime (bool isNonRealtime) noexcept
+    {
+        nonRealtime.store (isNonRealtime, std::memory_order_relaxed);
+    }
+
+    // Any thread. Decoding and preparation happen on the loader thread.
     void loadImpulseResponse (const juce::File& file)
     {
-        auto irBuffer = loader.loadImpulse (file);
-        // In a full implementation, turn this into a convolution IR
-        juce::ignoreUnused (irBuffer);
+        auto request = std::make_unique<LoadRequest>();
+        request->file = file;
+        queueRequest (std::move (request));
     }
 
-    void process (juce::AudioBuffer<float>& buffer)
+    // Any thread. Installs an in-memory IR (mono or stereo) recorded at irSampleRate.
+    void loadImpulseResponse (juce::AudioBuffer<float>&& irBuffer, double irSampleRate)
+    {
+        auto request = std::make_unique<LoadRequest>();
+        request->buffer = std::move (irBuffer);
+        request->bufferSampleRate = irSampleRate;
+        queueRequest (std::move (request));
+    }
+
+    // Wet signal gain relative to the (unit-energy) IR; ramped on the audio thread.
+    void setWetLevel (float newLevel) noexcept
+    {
+        wetLevel.store (juce::jlimit (0.0f, 4.0f, newLevel), std::memory_order_relaxed);
+    }
+
+    float getWetLevel() const noexcept { return wetLevel.load (std::memory_order_relaxed); }
+
+    // True once the audio thread is running an IR.
+    bool hasImpulseResponse() const noexcept { return irActive.load (std::memory_order_acquire); }
+
+    struct StageSnapshot
+    {
+        int partitionSize = 0;
+        int numPartitions = 0;
+        int offsetSamples = 0;
+        double cpuLoad = 0.0;   // compute time / audio time for this stage (0.01 = 1% of one core)
+        int deadlineMisses = 0;
+    };
+
+    struct ReverbSnapshot
+    {
+        bool hasImpulseResponse = false;
+        int latencySamples = 0;
+        int numStages = 0;
+        std::array<StageSnapshot, (size_t) NonUniformConvolver::maxStages> stages {};
+    };
+
+    // Any thread. Per-stage figures accumulate since the current IR was built.
+    ReverbSnapshot getSnapshot() const
+    {
+        ReverbSnapshot s;
+        s.hasImpulseResponse = irActive.load (std::memory_order_acquire);
+        s.latencySamples = activeLatencySamples.load (std::memory_order_relaxed);
+
+        const auto ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+        const auto sampleRate = statsSampleRate.load (std::memory_order_relaxed);
+
+        for (size_t i = 0; i < stageStats.size(); ++i)
+        {
+            const auto& src = stageStats[i];
+            auto& dst = s.stages[i];
+
+            dst.partitionSize  = src.partitionSize.load (std::memory_order_relaxed);
+            dst.numPartitions  = src.numPartitions.load (std::memory_order_relaxed);
+            dst.offsetSamples  = src.offsetSamples.load (std::memory_order_relaxed);
+            dst.deadlineMisses = src.deadlineMisses.load (std::memory_order_relaxed);
+
+            const auto samples = src.samplesProcessed.load (std::memory_order_relaxed);
+            if (samples > 0 && sampleRate > 0.0)
+                dst.cpuLoad = ((double) src.busyTicks.load (std::memory_order_relaxed) / ticksPerSecond)
+                              / ((double) samples / sampleRate);
+
+            if (dst.partitionSize > 0)
+                s.numStages = (int) i + 1;
+        }
+
+        return s;
+    }
+
+    // Input peak below which a block counts as silent for tail tracking.
+    void setSilenceThreshold (float linearGain) noexcept
+    {
+        silenceThreshold = juce::jmax (0.0f, linearGain);
+    }
+
+    // True while processing is skipped because the tail has fully decayed.
+    bool isBypassed() const noexcept { return bypassed; }
+
+    // inputKnownSilent lets the caller skip the peak scan when it already
+    // knows nothing was rendered into buffer.
+    void process (juce::AudioBuffer<float>& buffer, bool inputKnownSilent = false)
+    {
+        process (buffer, buffer, inputKnownSilent);
+    }
+
+    // Send/return form: convolves input (e.g. a reverb send bus) and adds the
+    // wet return to output. Both must hold the same number of samples.
+    void process (const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output, bool inputKnownSilent)
     {
         if (! prepared.load (std::memory_order_acquire))
             return;
 
-        juce::dsp::AudioBlock<float> block (buffer);
-        juce::dsp::ProcessContextReplacing<float> ctx (block);
-        convolution.process (ctx);
+        adoptPendingConvolver();
+
+        if (current == nullptr)
+            return;
+
+        const auto waitForLateBlocks = nonRealtime.load (std::memory_order_relaxed);
+        current->setNonRealtime (waitForLateBlocks);
+        if (fadingOut != nullptr)
+            fadingOut->setNonRealtime (waitForLateBlocks);
+
+        const auto numSamples = juce::jmin (input.getNumSamples(), output.getNumSamples());
+        const auto inputSilent = inputKnownSilent
+                                   || input.getMagnitude (0, numSamples) < silenceThreshold;
+
+        if (! inputSilent)
+        {
+            silentSamples = 0;
+            bypassed = false;
+        }
+        else if (! bypassed)
+        {
+            // Once silence has outlasted the IR, the output is silent too:
+            // drop the stale state and stop processing.
+            silentSamples += numSamples;
+            if (silentSamples > current->getTailLengthSamples() + numSamples)
+            {
+                current->reset();
+                finishCrossfade();
+                bypassed = true;
+            }
+        }
+
+        if (bypassed)
+            return;
+
+        wetGain.setTargetValue (wetLevel.load (std::memory_order_relaxed));
+
+        const auto numChannels = juce::jmin (input.getNumChannels(), output.getNumChannels(),
+                                             wetCurrent.getNumChannels());
+
+        for (int offset = 0; offset < numSamples; offset += wetCurrent.getNumSamples())
+        {
+            const auto n = juce::jmin (wetCurrent.getNumSamples(), numSamples - offset);
+            processChunk (input, output, offset, n, numChannels);
+        }
     }
 
 private:
-    std::atomic<bool> prepared { false };
-    juce::dsp::Convolution convolution;
-    Logger& logger;
+    struct LoadRequest
+    {
+        juce::File file;
+        juce::AudioBuffer<float> buffer;
+        double bufferSampleRate = 0.0;
+    };
+
+    // The IR last asked for: a file (decoded lazily, only on a cache miss)
+    // or an in-memory buffer.
+    struct Source
+    {
+        juce::File file;
+        juce::String key; // cache key of file, empty for in-memory IRs
+        std::shared_ptr<const DecodedAudio> audio;
+    };
 
-    class Loader
+    struct Session
+    {
+        double sampleRate = 0.0;
+        int maxBlockSize = 0;
+        int numChannels = 2;
+        std::uint64_t generation = 0;
+    };
+
+    class LoaderThread : public juce::Thread
     {
     public:
-        Loader() = default;
+        explicit LoaderThread (ConvolutionEngine& ownerIn) : juce::Thread ("IR Loader"), owner (ownerIn) {}
 
-        Loader (const Loader&) = delete;
-        Loader& operator= (const Loader&) = delete;
-        Loader (Loader&&) = delete;
-        Loader& operator= (Loader&&) = delete;
+        void run() override
+        {
+            while (! threadShouldExit())
+            {
+                owner.serviceLoader();
+                wait (50);
+            }
+        }
 
-        juce::AudioBuffer<float> loadImpulse (const juce::File& file)
+    private:
+        ConvolutionEngine& owner;
+    };
+
+    // ---------------------------------------------------------------------
+    // Audio thread
+
+    // input and output may be the same buffer: the wet signal is computed
+    // into scratch before anything is added.
+    void processChunk (const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                       int offset, int n, int numChannels) noexcept
+    {
+        const float* in[2] {};
+        float* wetA[2] {};
+        float* wetB[2] {};
+
+        for (int ch = 0; ch < numChannels; ++ch)
         {
-            juce::AudioBuffer<float> buffer;
-            if (! file.existsAsFile())
-                return buffer;
+            in[ch]   = input.getReadPointer (ch, offset);
+            wetA[ch] = wetCurrent.getWritePointer (ch);
+            wetB[ch] = wetFading.getWritePointer (ch);
+        }
+
+        current->process (in, wetA, numChannels, n);
 
-            juce::AudioFormatManager fm;
-            fm.registerBasicFormats();
+        if (fadingOut != nullptr)
+            fadingOut->process (in, wetB, numChannels, n);
 
-            std::unique_ptr<juce::AudioFormatReader> reader (fm.createReaderFor (file));
-            if (reader == nullptr)
-                return buffer;
+        for (int i = 0; i < n; ++i)
+        {
+            const auto gain = wetGain.getNextValue();
+            auto fadeIn = 1.0f;
 
-            buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
-            reader->read (&buffer, 0, (int) reader->lengthInSamples, 0, true, true);
-            return buffer;
+            if (crossfadeRemaining > 0)
+            {
+                fadeIn = 1.0f - (float) crossfadeRemaining / (float) crossfadeSamples;
+                --crossfadeRemaining;
+            }
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto wet = wetA[ch][i] * fadeIn;
+                if (fadingOut != nullptr)
+                    wet += wetB[ch][i] * (1.0f - fadeIn);
+
+                output.getWritePointer (ch, offset)[i] += gain * wet;
+            }
         }
-    };
 
-    Loader loader;
+        if (crossfadeRemaining == 0)
+            finishCrossfade();
+    }
+
+    void adoptPendingConvolver() noexcept
+    {
+        // One swap at a time: wait for the loader to collect the last retired convolver.
+        if (crossfadeRemaining > 0 || retiredConvolver.load (std::memory_order_acquire) != nullptr)
+            return;
+
+        auto* next = pendingConvolver.exchange (nullptr, std::memory_order_acq_rel);
+        if (next == nullptr)
+            return;
+
+        fadingOut = current;
+        current = next;
+        crossfadeRemaining = crossfadeSamples;
+        silentSamples = 0;
+        bypassed = false;
+        activeLatencySamples.store (current->getLatencySamples(), std::memory_order_relaxed);
+        irActive.store (true, std::memory_order_release);
+    }
+
+    void finishCrossfade() noexcept
+    {
+        crossfadeRemaining = 0;
+
+        if (fadingOut != nullptr)
+        {
+            retiredConvolver.store (fadingOut, std::memory_order_release);
+            fadingOut = nullptr;
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Loader thread
+
+    void queueRequest (std::unique_ptr<LoadRequest> request)
+    {
+        {
+            const std::lock_guard<std::mutex> lock (requestLock);
+            pendingRequest = std::move (request); // latest request wins
+        }
+
+        loaderThread.notify();
+    }
+
+    void collectRetired()
+    {
+        delete retiredConvolver.exchange (nullptr, std::memory_order_acq_rel);
+    }
+
+    void serviceLoader()
+    {
+        collectRetired();
+
+        std::unique_ptr<LoadRequest> request;
+        bool rebuild = false;
+
+        {
+            const std::lock_guard<std::mutex> lock (requestLock);
+            request = std::move (pendingRequest);
+            rebuild = std::exchange (rebuildRequested, false);
+        }
+
+        auto candidate = source;
+
+        if (request != nullptr)
+        {
+            candidate = {};
+
+            if (request->file != juce::File())
+            {
+                candidate.file = request->file;
+                candidate.key = SharedResourceCache<DecodedAudio>::makeFileKey (request->file);
+            }
+            else
+            {
+                auto decoded = std::make_shared<DecodedAudio>();
+                decoded->buffer = std::move (request->buffer);
+                decoded->sampleRate = request->bufferSampleRate;
+                candidate.audio = std::move (decoded); // in-memory IRs have no identity to share by
+            }
+        }
+        else if (! rebuild)
+        {
+            return;
+        }
+
+        if (candidate.file == juce::File()
+            && (candidate.audio == nullptr || candidate.audio->buffer.getNumSamples() == 0))
+            return;
+
+        Session target;
+        {
+            const std::lock_guard<std::mutex> lock (sessionLock);
+            target = session;
+        }
+
+        if (target.sampleRate <= 0.0)
+        {
+            source = candidate;
+            return; // not prepared yet; prepare() asks for a rebuild
+        }
+
+        const auto stages = getStageSpectra (candidate, target);
+        if (stages == nullptr)
+        {
+            logger.log (Logger::LogLevel::Warning,
+                        "Could not load impulse response: " + candidate.file.getFullPathName());
+            return;
+        }
+
+        source = candidate;
+        auto convolver = std::make_unique<NonUniformConvolver> (*stages, target.numChannels, stageStats.data());
+
+        juce::String layout;
+        for (const auto& stage : *stages)
+            layout << (layout.isEmpty() ? "" : ", ") << stage->numPartitions << " x " << stage->partitionSize;
+
+        publish (std::move (convolver), target.generation, layout);
+    }
+
+    // Conditioned, partitioned spectra of an IR for target, or null if its file
+    // cannot be read. File-based IRs are looked up in the process-wide cache,
+    // then in the on-disk cache, and only decoded and transformed when both miss.
+    std::shared_ptr<const NonUniformConvolver::StageSpectra> getStageSpectra (const Source& ir, const Session& target)
+    {
+        const auto headPartition = getHeadPartitionSize (target.maxBlockSize);
+        const auto key = ir.key.isEmpty() ? juce::String()
+                                          : ir.key + "|" + juce::String (target.sampleRate) + "|" + juce::String (headPartition);
+
+        auto build = [this, &ir, &key, &target, headPartition]() -> std::shared_ptr<const NonUniformConvolver::StageSpectra>
+        {
+            if (key.isNotEmpty())
+                if (auto mapped = diskCache.load (key))
+                    return mapped;
+
+            const auto audio = ir.audio != nullptr ? ir.audio : loader.loadShared (ir.file);
+            if (audio == nullptr)
+                return nullptr;
+
+            const auto conditioned = conditionImpulse (audio->buffer, audio->sampleRate, target.sampleRate);
+            auto stages = std::make_shared<NonUniformConvolver::StageSpectra> (
+                NonUniformConvolver::createStageSpectra (conditioned, target.sampleRate, headPartition));
+
+            if (key.isNotEmpty() && ! diskCache.store (key, *stages))
+                logger.log (Logger::LogLevel::Warning,
+                            "Could not write impulse response cache: " + diskCache.getFileForKey (key).getFullPathName());
+
+            return stages;
+        };
+
+        if (key.isEmpty())
+            return build();
+
+        return SharedResourceCache<NonUniformConvolver::StageSpectra>::getInstance().getOrCreate (key, build);
+    }
+
+    void publish (std::unique_ptr<NonUniformConvolver> convolver, std::uint64_t generation, const juce::String& layout)
+    {
+        while (! loaderThread.threadShouldExit())
+        {
+            collectRetired();
+
+            {
+                const std::lock_guard<std::mutex> requests (requestLock);
+                if (pendingRequest != nullptr || rebuildRequested)
+                    return; // superseded before it was ever heard
+            }
+
+            {
+                const std::lock_guard<std::mutex> lock (sessionLock);
+                if (generation != session.generation)
+                    return; // prepared for a different rate/block size meanwhile
+
+                if (pendingConvolver.load (std::memory_order_acquire) == nullptr)
+                {
+                    logger.log (Logger::LogLevel::Info,
+                                "Impulse response ready: " + juce::String (convolver->getTailLengthSamples())
+                                    + " samples, partitions " + layout);
+                    pendingConvolver.store (convolver.release(), std::memory_order_release);
+                    return;
+                }
+            }
+
+            loaderThread.wait (5);
+        }
+    }
+
+    // Linear-phase low-pass at targetRate's Nyquist (flat to 0.45 targetRate,
+    // -90 dB from 0.5), applied centred so the IR onset doesn't move.
+    static juce::AudioBuffer<float> lowPassForDecimation (const juce::AudioBuffer<float>& source,
+                                                          int numChannels,
+                                                          double sourceRate,
+                                                          double targetRate)
+    {
+        const auto coefficients = juce::dsp::FilterDesign<float>::designFIRLowpassKaiserMethod (
+            (float) (0.475 * targetRate), sourceRate, (float) (0.05 * targetRate / sourceRate), -90.0f);
+
+        const auto* h = coefficients->getRawCoefficients();
+        const auto numTaps = (int) coefficients->getFilterOrder() + 1;
+        const auto centre = (numTaps - 1) / 2;
+        const auto numSamples = source.getNumSamples();
+
+        juce::AudioBuffer<float> filtered (numChannels, numSamples);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* x = source.getReadPointer (ch);
+            auto* y = filtered.getWritePointer (ch);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                // y[i] = sum h[j] x[i + centre - j], over the taps that land inside x
+                const auto first = juce::jmax (0, i + centre - (numSamples - 1));
+                const auto last  = juce::jmin (numTaps - 1, i + centre);
+
+                float sum = 0.0f;
+                for (int j = first; j <= last; ++j)
+                    sum += h[j] * x[i + centre - j];
+
+                y[i] = sum;
+            }
+        }
+
+        return filtered;
+    }
+
+    // Resample to the session rate, trim the inaudible tail, normalise to unit energy.
+    static juce::AudioBuffer<float> conditionImpulse (const juce::AudioBuffer<float>& source,
+                                                      double sourceRate,
+                                                      double targetRate)
+    {
+        const auto numChannels = juce::jlimit (1, 2, source.getNumChannels());
+        juce::AudioBuffer<float> ir;
+
+        if (sourceRate > 0.0 && std::abs (sourceRate - targetRate) > 0.01)
+        {
+            const auto ratio = sourceRate / targetRate;
+            const auto numOut = juce::jmax (1, (int) std::ceil (source.getNumSamples() / ratio));
+            ir.setSize (numChannels, numOut);
+
+            // The interpolator doesn't band-limit, so when decimating, remove
+            // everything above the new Nyquist first or it folds back down.
+            const auto bandLimited = ratio > 1.0 ? lowPassForDecimation (source, numChannels, sourceRate, targetRate)
+                                                 : juce::AudioBuffer<float>();
+            const auto& input = ratio > 1.0 ? bandLimited : source;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                juce::WindowedSincInterpolator interpolator;
+                interpolator.process (ratio, input.getReadPointer (ch), ir.getWritePointer (ch),
+                                      numOut, input.getNumSamples(), 0);
+            }
+        }
+        else
+        {
+            ir.setSize (numChannels, source.getNumSamples());
+            for (int ch = 0; ch < numChannels; ++ch)
+                ir.copyFrom (ch, 0, source, ch, 0, source.getNumSamples());
+        }
+
+        const auto peak = ir.getMagnitude (0, ir.getNumSamples());
+        if (peak <= 0.0f)
+            return ir;
+
+        // -80 dB below the peak counts as the end of the tail
+        int length = 1;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* d = ir.getReadPointer (ch);
+            for (int i = ir.getNumSamples() - 1; i >= length; --i)
+                if (std::abs (d[i]) > peak * 1.0e-4f)
+                {
+                    length = i + 1;
+                    break;
+                }
+        }
+
+        ir.setSize (numChannels, length, true);
+
+        double maxEnergy = 0.0;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            double energy = 0.0;
+            const auto* d = ir.getReadPointer (ch);
+            for (int i = 0; i < length; ++i)
+                energy += (double) d[i] * d[i];
+            maxEnergy = juce::jmax (maxEnergy, energy);
+        }
+
+        if (maxEnergy > 0.0)
+            ir.applyGain ((float) (1.0 / std::sqrt (maxEnergy)));
+
+        return ir;
+    }
+
+    // The head runs on the audio thread every block, so it tracks the block size.
+    static int getHeadPartitionSize (int maxBlockSize) noexcept
+    {
+        return juce::jlimit (64, 1024, juce::nextPowerOfTwo (maxBlockSize));
+    }
+
+    // Audio stopped (prepare/destructor) only.
+    void releaseConvolvers()
+    {
+        delete pendingConvolver.exchange (nullptr, std::memory_order_acq_rel);
+        delete retiredConvolver.exchange (nullptr, std::memory_order_acq_rel);
+        delete fadingOut;
+        delete current;
+        fadingOut = nullptr;
+        current = nullptr;
+        crossfadeRemaining = 0;
+        activeLatencySamples.store (0, std::memory_order_relaxed);
+        irActive.store (false, std::memory_order_release);
+    }
+
+    std::atomic<bool> prepared { false };
+    Logger& logger;
+
+    // Loader thread side
+    std::mutex requestLock;
+    std::unique_ptr<LoadRequest> pendingRequest;
+    bool rebuildRequested = false;
+
+    std::mutex sessionLock;
+    Session session;
+
+    Source source; // loader thread only: kept for rebuilds after prepare()
+
+    // Hand-over slots between the loader and the audio thread
+    std::atomic<NonUniformConvolver*> pendingConvolver { nullptr };
+    std::atomic<NonUniformConvolver*> retiredConvolver { nullptr };
+    std::atomic<bool> irActive { false };
+    std::atomic<int> activeLatencySamples { 0 }; // of the convolver the audio thread runs
+    std::array<ConvolutionStageStats, (size_t) NonUniformConvolver::maxStages> stageStats;
+    std::atomic<double> statsSampleRate { 0.0 };
+    std::atomic<float> wetLevel { 0.25f };
+    std::atomic<bool> nonRealtime { false };
+
+    // Audio thread only
+    NonUniformConvolver* current = nullptr;
+    NonUniformConvolver* fadingOut = nullptr;
+    int crossfadeSamples = 1;
+    int crossfadeRemaining = 0;
+    juce::AudioBuffer<float> wetCurrent, wetFading;
+    juce::SmoothedValue<float> wetGain { 0.25f };
+    float silenceThreshold = 0.0f;
+    int silentSamples = 0;
+    bool bypassed = false;
+
+    ImpulseResponseLoader loader;
+    ImpulseResponseDiskCache diskCache;
+    LoaderThread loaderThread;
 };
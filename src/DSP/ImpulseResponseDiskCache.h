@@ -0,0 +1,301 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "NonUniformConvolver.h"
+
+// Persistent cache of conditioned, partitioned IR spectra.
+//
+// One file per (IR file, sample rate, head partition) key, holding every
+// stage's spectra exactly as the convolvers use them. Loading maps the file
+// read-only and points the spectra straight at it, so re-opening a session
+// costs a page-in instead of a decode, resample and a few thousand FFTs.
+//
+// File layout (native byte order, which the magic number doubles as a
+// check for):
+//   FileHeader
+//   key bytes (UTF-8), verified on load against hash collisions
+//   StageHeader[numStages]
+//   float data per stage, each block aligned to dataAlignment
+//
+// Bump formatVersion whenever the layout or the IR conditioning changes;
+// files of any other version are ignored and rewritten. Files whose stages
+// don't match NonUniformConvolver's partition layout are treated the same.
+//
+// Every key (IR mtime, sample rate, block size) gets its own file, so after
+// each store() the least recently used files beyond maxBytes are deleted.
+//
+// Background threads only.
+class ImpulseResponseDiskCache
+{
+public:
+    static constexpr std::uint32_t magic = 0x5249534f; // "OSIR"
+    static constexpr std::uint32_t formatVersion = 2;
+    static constexpr std::uint64_t dataAlignment = 64;
+    static constexpr juce::int64 defaultMaxBytes = (juce::int64) 512 << 20;
+
+    explicit ImpulseResponseDiskCache (juce::File directoryIn = getDefaultDirectory(),
+                                       juce::int64 maxBytesIn = defaultMaxBytes)
+        : directory (std::move (directoryIn)),
+          maxBytes (maxBytesIn)
+    {
+    }
+
+    ImpulseResponseDiskCache (const ImpulseResponseDiskCache&) = delete;
+    ImpulseResponseDiskCache& operator= (const ImpulseResponseDiskCache&) = delete;
+    ImpulseResponseDiskCache (ImpulseResponseDiskCache&&) = delete;
+    ImpulseResponseDiskCache& operator= (ImpulseResponseDiskCache&&) = delete;
+
+    static juce::File getDefaultDirectory()
+    {
+        return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                   .getChildFile ("OrchestraSynth")
+                   .getChildFile ("IRCache");
+    }
+
+    // Null if there is no valid cache file for key.
+    std::shared_ptr<const NonUniformConvolver::StageSpectra> load (const juce::String& key) const
+    {
+        const auto file = getFileForKey (key);
+        if (! file.existsAsFile())
+            return nullptr;
+
+        auto mapping = std::make_shared<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+        const auto* base = static_cast<const std::uint8_t*> (mapping->getData());
+        const auto size = (std::uint64_t) mapping->getSize();
+
+        if (base == nullptr || size < sizeof (FileHeader))
+            return nullptr;
+
+        FileHeader header;
+        std::memcpy (&header, base, sizeof (header));
+
+        const auto keyUtf8 = key.toStdString();
+        const auto stagesOffset = (std::uint64_t) sizeof (FileHeader) + header.keyBytes;
+
+        if (header.magic != magic || header.version != formatVersion
+            || header.numStages < 1 || header.numStages > (std::uint32_t) NonUniformConvolver::maxStages
+            || header.keyBytes != keyUtf8.size()
+            || stagesOffset + header.numStages * sizeof (StageHeader) > size
+            || std::memcmp (base + sizeof (FileHeader), keyUtf8.data(), keyUtf8.size()) != 0)
+            return nullptr;
+
+        auto stages = std::make_shared<NonUniformConvolver::StageSpectra>();
+
+        for (std::uint32_t i = 0; i < header.numStages; ++i)
+        {
+            StageHeader sh;
+            std::memcpy (&sh, base + stagesOffset + i * sizeof (StageHeader), sizeof (sh));
+
+            auto spectra = std::make_shared<ImpulseResponseSpectra>();
+            spectra->partitionSize   = sh.partitionSize;
+            spectra->fftOrder        = sh.fftOrder;
+            spectra->fftSize         = sh.fftSize;
+            spectra->numBins         = sh.numBins;
+            spectra->numPartitions   = sh.numPartitions;
+            spectra->numChannels     = sh.numChannels;
+            spectra->offsetSamples   = sh.offsetSamples;
+            spectra->lengthInSamples = sh.lengthInSamples;
+            spectra->sampleRate      = sh.sampleRate;
+
+            // Range-check fftOrder before shifting by it.
+            const auto consistent = sh.fftOrder >= minFftOrder && sh.fftOrder <= maxFftOrder
+                                    && sh.partitionSize >= 16
+                                    && sh.fftSize == 2 * sh.partitionSize
+                                    && sh.fftSize == (1 << sh.fftOrder)
+                                    && sh.numBins == sh.fftSize / 2 + 1
+                                    && sh.lengthInSamples > 0
+                                    && sh.numPartitions == (sh.lengthInSamples + sh.partitionSize - 1) / sh.partitionSize
+                                    && sh.numChannels >= 1 && sh.numChannels <= 2
+                                    && sh.sampleRate > 0.0
+                                    && sh.numFloats == spectra->getNumFloats()
+                                    && sh.dataOffset % dataAlignment == 0
+                                    && sh.dataOffset <= size
+                                    && sh.numFloats * sizeof (float) <= size - sh.dataOffset;
+            if (! consistent || ! followsStageLayout (sh, i == 0 ? nullptr : stages->back().get()))
+                return nullptr;
+
+            spectra->mapping = mapping;
+            spectra->mappedData = reinterpret_cast<const float*> (base + sh.dataOffset);
+            stages->push_back (std::move (spectra));
+        }
+
+        // Most recently used files survive pruning
+        file.setLastAccessTime (juce::Time::getCurrentTime());
+        return stages;
+    }
+
+    // Writes via a temporary file, so readers never see a half-written entry.
+    bool store (const juce::String& key, const NonUniformConvolver::StageSpectra& stages) const
+    {
+        if (stages.empty() || (int) stages.size() > NonUniformConvolver::maxStages
+            || ! directory.createDirectory())
+            return false;
+
+        const auto keyUtf8 = key.toStdString();
+
+        FileHeader header;
+        header.magic = magic;
+        header.version = formatVersion;
+        header.keyBytes = (std::uint32_t) keyUtf8.size();
+        header.numStages = (std::uint32_t) stages.size();
+
+        std::vector<StageHeader> stageHeaders (stages.size());
+        auto offset = align ((std::uint64_t) sizeof (FileHeader) + keyUtf8.size()
+                             + stages.size() * sizeof (StageHeader));
+
+        for (size_t i = 0; i < stages.size(); ++i)
+        {
+            const auto& s = *stages[i];
+            auto& sh = stageHeaders[i];
+
+            sh.partitionSize   = s.partitionSize;
+            sh.fftOrder        = s.fftOrder;
+            sh.fftSize         = s.fftSize;
+            sh.numBins         = s.numBins;
+            sh.numPartitions   = s.numPartitions;
+            sh.numChannels     = s.numChannels;
+            sh.offsetSamples   = s.offsetSamples;
+            sh.lengthInSamples = s.lengthInSamples;
+            sh.sampleRate      = s.sampleRate;
+            sh.dataOffset      = offset;
+            sh.numFloats       = s.getNumFloats();
+
+            offset = align (offset + sh.numFloats * sizeof (float));
+        }
+
+        const auto file = getFileForKey (key);
+        juce::TemporaryFile temp (file);
+
+        {
+            juce::FileOutputStream out (temp.getFile());
+            if (! out.openedOk())
+                return false;
+
+            auto ok = out.write (&header, sizeof (header))
+                      && out.write (keyUtf8.data(), keyUtf8.size())
+                      && out.write (stageHeaders.data(), stageHeaders.size() * sizeof (StageHeader));
+
+            for (size_t i = 0; ok && i < stages.size(); ++i)
+            {
+                ok = pad (out, stageHeaders[i].dataOffset)
+                     && out.write (stages[i]->getData(), stageHeaders[i].numFloats * sizeof (float));
+            }
+
+            ok = ok && pad (out, offset);
+            out.flush();
+
+            if (! ok || out.getStatus().failed())
+                return false;
+        }
+
+        if (! temp.overwriteTargetFileWithTemporary())
+            return false;
+
+        prune (file);
+        return true;
+    }
+
+    // Deletes the least recently used cache files until the rest fit in
+    // maxBytes. keep is never deleted, even if it alone is over the cap.
+    void prune (const juce::File& keep) const
+    {
+        struct Entry
+        {
+            juce::File file;
+            juce::Time lastUsed;
+            juce::int64 bytes;
+        };
+
+        std::vector<Entry> entries;
+
+        for (const auto& f : directory.findChildFiles (juce::File::findFiles, false, "*.osir"))
+            if (f != keep)
+                entries.push_back ({ f, f.getLastAccessTime(), f.getSize() });
+
+        std::sort (entries.begin(), entries.end(), [] (const Entry& a, const Entry& b) { return a.lastUsed > b.lastUsed; });
+
+        auto total = keep.getSize();
+
+        for (const auto& e : entries)
+        {
+            total += e.bytes;
+            if (total > maxBytes)
+                e.file.deleteFile(); // may fail while mapped (Windows); retried on the next store()
+        }
+    }
+
+    juce::File getFileForKey (const juce::String& key) const
+    {
+        return directory.getChildFile (juce::String::toHexString (key.hashCode64()) + ".osir");
+    }
+
+    const juce::File& getDirectory() const noexcept { return directory; }
+
+private:
+    struct FileHeader
+    {
+        std::uint32_t magic = 0;
+        std::uint32_t version = 0;
+        std::uint32_t keyBytes = 0;
+        std::uint32_t numStages = 0;
+    };
+
+    struct StageHeader
+    {
+        std::int32_t partitionSize = 0;
+        std::int32_t fftOrder = 0;
+        std::int32_t fftSize = 0;
+        std::int32_t numBins = 0;
+        std::int32_t numPartitions = 0;
+        std::int32_t numChannels = 0;
+        std::int32_t offsetSamples = 0;
+        std::int32_t lengthInSamples = 0;
+        double sampleRate = 0.0;
+        std::uint64_t dataOffset = 0; // bytes from the start of the file
+        std::uint64_t numFloats = 0;
+    };
+
+    static constexpr int minFftOrder = 5;  // 16-sample head partition
+    static constexpr int maxFftOrder = 20;
+
+    // Stage offsets and partition sizes as NonUniformConvolver::createStageSpectra()
+    // lays them out: the head starts at 0, each tail at 2P of its own partition
+    // P = growthFactor * the previous one, right where the previous stage ends.
+    static bool followsStageLayout (const StageHeader& sh, const ImpulseResponseSpectra* previous) noexcept
+    {
+        if (previous == nullptr)
+            return sh.offsetSamples == 0;
+
+        return sh.partitionSize == previous->partitionSize * NonUniformConvolver::growthFactor
+               && sh.partitionSize <= NonUniformConvolver::maxTailPartition
+               && sh.offsetSamples == 2 * sh.partitionSize
+               && sh.offsetSamples == previous->offsetSamples + previous->lengthInSamples;
+    }
+
+    static std::uint64_t align (std::uint64_t offset) noexcept
+    {
+        return (offset + dataAlignment - 1) / dataAlignment * dataAlignment;
+    }
+
+    static bool pad (juce::FileOutputStream& out, std::uint64_t targetOffset)
+    {
+        static const std::uint8_t zeros[dataAlignment] {};
+
+        while ((std::uint64_t) out.getPosition() < targetOffset)
+        {
+            const auto n = juce::jmin ((std::uint64_t) dataAlignment, targetOffset - (std::uint64_t) out.getPosition());
+            if (! out.write (zeros, (size_t) n))
+                return false;
+        }
+
+        return true;
+    }
+
+    juce::File directory;
+    juce::int64 maxBytes;
+};
@@ -2,11 +2,24 @@
 
 #include <JuceHeader.h>
 #include <atomic>
+#include <memory>
+#include "../Systems/SharedResourceCache.h"
+
+// An audio file decoded to float at its native rate. Immutable once built,
+// shared between instances through SharedResourceCache<DecodedAudio>.
+struct DecodedAudio
+{
+    juce::AudioBuffer<float> buffer;
+    double sampleRate = 0.0;
+};
 
 class ImpulseResponseLoader
 {
 public:
-    ImpulseResponseLoader() = default;
+    ImpulseResponseLoader()
+    {
+        formatManager.registerBasicFormats();
+    }
 
     ImpulseResponseLoader (const ImpulseResponseLoader&) = delete;
     ImpulseResponseLoader& operator= (const ImpulseResponseLoader&) = delete;
@@ -18,7 +31,32 @@ public:
         bool lastLoadSucceeded = false;
     };
 
+    // Decodes file once per process; later calls (from any instance) share
+    // the same buffer until the last user lets go. Null if unreadable.
+    std::shared_ptr<const DecodedAudio> loadShared (const juce::File& file)
+    {
+        auto decoded = SharedResourceCache<DecodedAudio>::getInstance().getOrCreate (
+            SharedResourceCache<DecodedAudio>::makeFileKey (file),
+            [this, &file]() -> std::shared_ptr<const DecodedAudio>
+            {
+                auto result = std::make_shared<DecodedAudio>();
+                result->buffer = load (file, result->sampleRate);
+                if (result->buffer.getNumSamples() == 0)
+                    return nullptr;
+                return result;
+            });
+
+        success.store (decoded != nullptr, std::memory_order_release);
+        return decoded;
+    }
+
     juce::AudioBuffer<float> load (const juce::File& file)
+    {
+        double sampleRate = 0.0;
+        return load (file, sampleRate);
+    }
+
+    juce::AudioBuffer<float> load (const juce::File& file, double& sampleRateOut)
     {
         juce::AudioBuffer<float> buffer;
         success.store (false, std::memory_order_relaxed);
@@ -26,14 +64,13 @@ public:
         if (! file.existsAsFile())
             return buffer;
 
-        juce::AudioFormatManager fmt;
-        fmt.registerBasicFormats();
-        std::unique_ptr<juce::AudioFormatReader> reader (fmt.createReaderFor (file));
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
         if (reader == nullptr)
             return buffer;
 
         buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
         reader->read (&buffer, 0, (int) reader->lengthInSamples, 0, true, true);
+        sampleRateOut = reader->sampleRate;
         success.store (true, std::memory_order_release);
         return buffer;
     }
@@ -46,5 +83,6 @@ public:
     }
 
 private:
+    juce::AudioFormatManager formatManager; // formats registered once, not per load
     std::atomic<bool> success { false };
 };
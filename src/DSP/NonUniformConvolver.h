@@ -0,0 +1,487 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "PartitionedConvolver.h"
+
+// Live per-stage figures, owned by ConvolutionEngine so they outlive the
+// convolvers that write them. Readable from any thread.
+struct ConvolutionStageStats
+{
+    std::atomic<int> partitionSize { 0 };
+    std::atomic<int> numPartitions { 0 };
+    std::atomic<int> offsetSamples { 0 };
+    std::atomic<std::int64_t> busyTicks { 0 };        // high-resolution ticks spent computing
+    std::atomic<std::int64_t> samplesProcessed { 0 }; // audio samples those ticks covered
+    std::atomic<int> deadlineMisses { 0 };            // a tail block was not ready at its deadline
+};
+
+// Non-uniformly partitioned convolution: a zero-latency head plus tail
+// stages whose partitions grow by growthFactor along the IR.
+//
+//   head    PartitionedConvolver, partition B, IR [0, 2 * P1)
+//   tail 1  partition P1 = 8B,  IR [2 * P1, 2 * P2)
+//   tail 2  partition P2 = 64B, IR [2 * P2, ...)      up to maxTailPartition
+//
+// A tail stage with partition P collects P input samples, then its block is
+// convolved on the tail worker thread while the next P samples play. Its IR
+// segment starts 2P into the response, so the result is due exactly when
+// the following block completes; the audio thread only swaps buffers. If
+// the worker is late, the miss is counted and, in real time, that stage
+// plays silence for the late block and drops the input block it could not
+// hand over; the worker shifts its history past the gap, so later blocks
+// stay aligned. Offline (setNonRealtime (true)), where rendering faster
+// than real time makes the worker legitimately late, the audio thread
+// waits for it instead.
+//
+// Long IRs therefore cost a handful of small FFTs per block on the audio
+// thread plus a few large, amortised FFTs in the background, instead of
+// thousands of small-partition multiply-adds per block.
+//
+// Construction/destruction on a non-audio thread; process()/reset() on the
+// audio thread only.
+class NonUniformConvolver
+{
+public:
+    static constexpr int maxStages = 4;
+    static constexpr int growthFactor = 8;
+    static constexpr int maxTailPartition = 16384;
+
+    using StageSpectra = std::vector<std::shared_ptr<const ImpulseResponseSpectra>>;
+
+    // Splits a conditioned IR into head + tail segments; background thread only.
+    static StageSpectra createStageSpectra (const juce::AudioBuffer<float>& ir, double sampleRate, int headPartition)
+    {
+        StageSpectra stages;
+
+        auto partition = juce::nextPowerOfTwo (juce::jmax (16, headPartition));
+        auto offset = 0;
+        const auto length = juce::jmax (1, ir.getNumSamples());
+
+        while (offset < length && (int) stages.size() < maxStages)
+        {
+            const auto nextPartition = partition * growthFactor;
+            const auto isLast = (int) stages.size() == maxStages - 1
+                                || nextPartition > maxTailPartition
+                                || 2 * nextPartition >= length;
+
+            const auto end = isLast ? length : 2 * nextPartition;
+            stages.push_back (ImpulseResponseSpectra::create (ir, sampleRate, partition, offset, end - offset));
+
+            offset = end;
+            partition = nextPartition;
+        }
+
+        return stages;
+    }
+
+    NonUniformConvolver (const StageSpectra& stageSpectra,
+                         int numChannelsIn,
+                         ConvolutionStageStats* statsIn = nullptr)
+        : numChannels (juce::jlimit (1, 2, numChannelsIn)),
+          stats (statsIn),
+          worker (*this)
+    {
+        jassert (! stageSpectra.empty());
+
+        head = std::make_unique<PartitionedConvolver> (stageSpectra.front(), numChannels);
+
+        for (size_t i = 1; i < stageSpectra.size(); ++i)
+            tails.push_back (std::make_unique<TailStage> (stageSpectra[i], numChannels));
+
+        const auto& last = stageSpectra.back();
+        lengthInSamples = last->offsetSamples + last->lengthInSamples;
+
+        // A tail block is due 2P after its input block starts, so a segment
+        // starting any earlier would play late relative to the head.
+        for (const auto& tail : tails)
+            jassertquiet (tail->spectra->offsetSamples >= 2 * tail->partitionSize);
+
+        latencySamples = head->getLatencySamples();
+
+        if (stats != nullptr)
+        {
+            for (size_t i = 0; i < (size_t) maxStages; ++i)
+            {
+                auto& s = stats[i];
+                const auto* spectra = i < stageSpectra.size() ? stageSpectra[i].get() : nullptr;
+                s.partitionSize.store (spectra != nullptr ? spectra->partitionSize : 0, std::memory_order_relaxed);
+                s.numPartitions.store (spectra != nullptr ? spectra->numPartitions : 0, std::memory_order_relaxed);
+                s.offsetSamples.store (spectra != nullptr ? spectra->offsetSamples : 0, std::memory_order_relaxed);
+                s.busyTicks.store (0, std::memory_order_relaxed);
+                s.samplesProcessed.store (0, std::memory_order_relaxed);
+                s.deadlineMisses.store (0, std::memory_order_relaxed);
+            }
+        }
+
+        if (! tails.empty() && ! worker.startRealtimeThread (juce::Thread::RealtimeOptions{}))
+            worker.startThread (juce::Thread::Priority::highest);
+    }
+
+    ~NonUniformConvolver()
+    {
+        worker.signalThreadShouldExit();
+        wakeCounter.fetch_add (1, std::memory_order_release);
+        wakeCounter.notify_all();
+        worker.stopThread (2000);
+    }
+
+    NonUniformConvolver (const NonUniformConvolver&) = delete;
+    NonUniformConvolver& operator= (const NonUniformConvolver&) = delete;
+    NonUniformConvolver (NonUniformConvolver&&) = delete;
+    NonUniformConvolver& operator= (NonUniformConvolver&&) = delete;
+
+    // Writes the wet signal for numSamples of input. input and output may not alias.
+    void process (const float* const* input, float* const* output, int numChannelsToProcess, int numSamples) noexcept
+    {
+        numChannelsToProcess = juce::jmin (numChannelsToProcess, numChannels);
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        head->process (input, output, numChannelsToProcess, numSamples);
+        addStageTime (0, juce::Time::getHighResolutionTicks() - start, numSamples);
+
+        for (size_t i = 0; i < tails.size(); ++i)
+        {
+            auto& tail = *tails[i];
+            int done = 0;
+
+            while (done < numSamples)
+            {
+                const auto n = juce::jmin (numSamples - done, tail.partitionSize - tail.position);
+                tail.exchangeSamples (input, output, numChannelsToProcess, done, n);
+
+                if (tail.position == tail.partitionSize)
+                    startTailBlock ((int) i + 1, tail);
+
+                done += n;
+            }
+        }
+    }
+
+    // Clears all state. A tail block still being computed is discarded, and
+    // the worker clears that stage's history before its next block.
+    void reset() noexcept
+    {
+        head->reset();
+
+        for (auto& tail : tails)
+            tail->resetFromAudioThread();
+    }
+
+    // Offline rendering: wait for late tail blocks instead of dropping them.
+    void setNonRealtime (bool isNonRealtime) noexcept { waitForLateBlocks = isNonRealtime; }
+
+    int getTailLengthSamples() const noexcept { return lengthInSamples; }
+
+    // The tails are scheduled against the head, so this is the head's delay.
+    int getLatencySamples() const noexcept { return latencySamples; }
+
+    int getNumStages() const noexcept { return 1 + (int) tails.size(); }
+
+private:
+    struct TailStage
+    {
+        TailStage (std::shared_ptr<const ImpulseResponseSpectra> spectraIn, int numChannelsIn)
+            : spectra (std::move (spectraIn)),
+              fft (spectra->fftOrder),
+              partitionSize (spectra->partitionSize),
+              numChannels (numChannelsIn)
+        {
+            const auto spectrumSize = (size_t) spectra->getSpectrumSize();
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto& c = channels[(size_t) ch];
+                c.input.assign ((size_t) partitionSize, 0.0f);
+                c.jobInput.assign ((size_t) partitionSize, 0.0f);
+                c.output.assign ((size_t) partitionSize, 0.0f);
+                c.nextOutput.assign ((size_t) partitionSize, 0.0f);
+                c.overlap.assign ((size_t) partitionSize, 0.0f);
+                c.fftBuffer.assign ((size_t) spectra->fftSize * 2, 0.0f);
+                c.delayLine.assign ((size_t) spectra->numPartitions * spectrumSize, 0.0f);
+                c.accumulator.assign (spectrumSize, 0.0f);
+            }
+        }
+
+        // Audio thread: append input, add the block that is currently due to output.
+        void exchangeSamples (const float* const* in, float* const* out, int numCh, int offset, int n) noexcept
+        {
+            for (int ch = 0; ch < numCh; ++ch)
+            {
+                auto& c = channels[(size_t) ch];
+                std::copy (in[ch] + offset, in[ch] + offset + n, c.input.begin() + position);
+                juce::FloatVectorOperations::add (out[ch] + offset, c.output.data() + position, n);
+            }
+
+            position += n;
+        }
+
+        // Worker thread: non-zero-latency UPOLS step for the block in jobInput.
+        void compute() noexcept
+        {
+            applyPendingHistoryChanges();
+
+            const auto spectrumSize = (size_t) spectra->getSpectrumSize();
+            const auto numBins = spectra->numBins;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto& c = channels[(size_t) ch];
+                const auto irChannel = juce::jmin (ch, spectra->numChannels - 1);
+                auto* fftData = c.fftBuffer.data();
+
+                std::copy (c.jobInput.begin(), c.jobInput.end(), fftData);
+                std::fill (fftData + partitionSize, fftData + c.fftBuffer.size(), 0.0f);
+                fft.performRealOnlyForwardTransform (fftData, true);
+
+                ImpulseResponseSpectra::splitSpectrum (fftData, c.delayLine.data() + (size_t) segment * spectrumSize, numBins);
+
+                std::fill (c.accumulator.begin(), c.accumulator.end(), 0.0f);
+                auto index = segment;
+                for (int p = 0; p < spectra->numPartitions; ++p)
+                {
+                    ImpulseResponseSpectra::multiplyAccumulate (c.delayLine.data() + (size_t) index * spectrumSize,
+                                                                spectra->getPartition (irChannel, p),
+                                                                c.accumulator.data(),
+                                                                numBins);
+                    if (++index >= spectra->numPartitions)
+                        index = 0;
+                }
+
+                ImpulseResponseSpectra::mergeSpectrum (c.accumulator.data(), fftData, numBins, spectra->fftSize);
+                fft.performRealOnlyInverseTransform (fftData);
+
+                for (int i = 0; i < partitionSize; ++i)
+                    c.nextOutput[(size_t) i] = fftData[i] + c.overlap[(size_t) i];
+
+                std::copy (fftData + partitionSize, fftData + 2 * partitionSize, c.overlap.begin());
+            }
+
+            segment = segment > 0 ? segment - 1 : spectra->numPartitions - 1;
+        }
+
+        // Worker thread (or audio thread while no job is pending): applies the
+        // gaps and resets the audio thread handed over with the current job.
+        void applyPendingHistoryChanges() noexcept
+        {
+            const auto spectrumSize = (size_t) spectra->getSpectrumSize();
+
+            if (jobResetHistory)
+            {
+                for (auto& c : channels)
+                {
+                    std::fill (c.delayLine.begin(), c.delayLine.end(), 0.0f);
+                    std::fill (c.overlap.begin(), c.overlap.end(), 0.0f);
+                }
+
+                segment = 0;
+            }
+            else if (jobSkippedBlocks > 0)
+            {
+                // Dropped input blocks enter the history as silence
+                for (int b = 0; b < juce::jmin (jobSkippedBlocks, spectra->numPartitions); ++b)
+                {
+                    for (auto& c : channels)
+                    {
+                        auto* slot = c.delayLine.data() + (size_t) segment * spectrumSize;
+                        std::fill (slot, slot + spectrumSize, 0.0f);
+                    }
+
+                    segment = segment > 0 ? segment - 1 : spectra->numPartitions - 1;
+                }
+
+                // Belonged to the output block that was played as silence
+                for (auto& c : channels)
+                    std::fill (c.overlap.begin(), c.overlap.end(), 0.0f);
+            }
+
+            jobResetHistory = false;
+            jobSkippedBlocks = 0;
+        }
+
+        // Audio thread, the worker missed this block's deadline: play silence
+        // for the next partition and drop the input that could not be handed over.
+        void dropBlock() noexcept
+        {
+            for (auto& c : channels)
+            {
+                std::fill (c.input.begin(), c.input.end(), 0.0f);
+                std::fill (c.output.begin(), c.output.end(), 0.0f);
+            }
+
+            position = 0;
+            ++droppedBlocks;
+            nextOutputStale = true;
+        }
+
+        void resetFromAudioThread() noexcept
+        {
+            for (auto& c : channels)
+            {
+                std::fill (c.input.begin(), c.input.end(), 0.0f);
+                std::fill (c.output.begin(), c.output.end(), 0.0f);
+            }
+
+            position = 0;
+            droppedBlocks = 0;
+
+            if (jobPending.load (std::memory_order_acquire))
+            {
+                historyResetRequested = true;
+                nextOutputStale = true;
+                return;
+            }
+
+            // The worker is idle until the next job, so its side can be cleared here
+            for (auto& c : channels)
+            {
+                std::fill (c.jobInput.begin(), c.jobInput.end(), 0.0f);
+                std::fill (c.nextOutput.begin(), c.nextOutput.end(), 0.0f);
+            }
+
+            jobResetHistory = true;
+            applyPendingHistoryChanges();
+            historyResetRequested = false;
+            nextOutputStale = false;
+        }
+
+        struct Channel
+        {
+            std::vector<float> input;       // block being collected (audio thread)
+            std::vector<float> jobInput;    // block being convolved (worker)
+            std::vector<float> output;      // block being played (audio thread)
+            std::vector<float> nextOutput;  // block being produced (worker)
+            std::vector<float> overlap;
+            std::vector<float> fftBuffer;
+            std::vector<float> delayLine;
+            std::vector<float> accumulator;
+        };
+
+        std::shared_ptr<const ImpulseResponseSpectra> spectra;
+        juce::dsp::FFT fft;
+        const int partitionSize;
+        const int numChannels;
+
+        std::array<Channel, 2> channels;
+        int position = 0; // audio thread
+        int segment = 0;  // worker
+
+        // Audio thread: what happened since the last job was handed over
+        int droppedBlocks = 0;
+        bool historyResetRequested = false;
+        bool nextOutputStale = false;
+
+        // Handed to the worker with the job (published by jobPending)
+        int jobSkippedBlocks = 0;
+        bool jobResetHistory = false;
+
+        std::atomic<bool> jobPending { false };
+    };
+
+    class Worker : public juce::Thread
+    {
+    public:
+        explicit Worker (NonUniformConvolver& ownerIn) : juce::Thread ("Convolution tail"), owner (ownerIn) {}
+
+        void run() override
+        {
+            auto seenWake = owner.wakeCounter.load (std::memory_order_acquire);
+
+            while (! threadShouldExit())
+            {
+                // Smallest partitions have the closest deadlines, so go in stage order.
+                bool didWork = false;
+                for (size_t i = 0; i < owner.tails.size(); ++i)
+                {
+                    auto& tail = *owner.tails[i];
+                    if (! tail.jobPending.load (std::memory_order_acquire))
+                        continue;
+
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    tail.compute();
+                    owner.addStageTime ((int) i + 1, juce::Time::getHighResolutionTicks() - start, tail.partitionSize);
+
+                    tail.jobPending.store (false, std::memory_order_release);
+                    didWork = true;
+                }
+
+                if (! didWork)
+                {
+                    owner.wakeCounter.wait (seenWake, std::memory_order_acquire);
+                    seenWake = owner.wakeCounter.load (std::memory_order_acquire);
+                }
+            }
+        }
+
+    private:
+        NonUniformConvolver& owner;
+    };
+
+    // Audio thread, at a tail block boundary: take the finished block, hand over the new one.
+    void startTailBlock (int stageIndex, TailStage& tail) noexcept
+    {
+        if (tail.jobPending.load (std::memory_order_acquire))
+        {
+            if (stats != nullptr)
+                stats[stageIndex].deadlineMisses.fetch_add (1, std::memory_order_relaxed);
+
+            if (! waitForLateBlocks)
+            {
+                tail.dropBlock();
+                return;
+            }
+
+            while (tail.jobPending.load (std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        for (int ch = 0; ch < tail.numChannels; ++ch)
+        {
+            auto& c = tail.channels[(size_t) ch];
+            std::swap (c.output, c.nextOutput);
+            std::swap (c.input, c.jobInput);
+
+            // The finished block was due while silence played (or before a reset)
+            if (tail.nextOutputStale)
+                std::fill (c.output.begin(), c.output.end(), 0.0f);
+        }
+
+        tail.jobSkippedBlocks = tail.droppedBlocks;
+        tail.jobResetHistory = tail.historyResetRequested;
+        tail.droppedBlocks = 0;
+        tail.historyResetRequested = false;
+        tail.nextOutputStale = false;
+
+        tail.position = 0;
+        tail.jobPending.store (true, std::memory_order_release);
+
+        wakeCounter.fetch_add (1, std::memory_order_release);
+        wakeCounter.notify_one();
+    }
+
+    void addStageTime (int stageIndex, juce::int64 ticks, int numSamples) noexcept
+    {
+        if (stats == nullptr)
+            return;
+
+        stats[stageIndex].busyTicks.fetch_add (ticks, std::memory_order_relaxed);
+        stats[stageIndex].samplesProcessed.fetch_add (numSamples, std::memory_order_relaxed);
+    }
+
+    const int numChannels;
+    ConvolutionStageStats* stats = nullptr;
+    int lengthInSamples = 0;
+    int latencySamples = 0;
+    bool waitForLateBlocks = false; // audio thread
+
+    std::unique_ptr<PartitionedConvolver> head;
+    std::vector<std::unique_ptr<TailStage>> tails;
+
+    std::atomic<std::uint32_t> wakeCounter { 0 };
+    Worker worker;
+};
@@ -1,98 +1,166 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <array>
 #include <atomic>
-#include "../Systems/Logger.h"
+#include <memory>
 
-// Simple global oversampling / anti-alias stage using juce::dsp::Oversampling.
-// Pattern: process(buffer) will:
-//   1. Upsample buffer
-//   2. Apply low-pass anti-alias filter via Oversampling's internal filters
-//   3. Downsample back into the original buffer
+// Per-section oversampling around the section's mono render.
 //
-// This gives real anti-aliasing and spectral smoothing,
-// and is cheap enough to run post-mix.
-
+// process() hands the caller a buffer factor x longer than the block, runs
+// at factor x the host rate inside it, and decimates the result back through
+// juce::dsp::Oversampling's half-band filters. Anything nonlinear (oscillators,
+// filters, saturation) rendered in the callback aliases far less.
+//
+// One juce::dsp::Oversampling per supported factor (2x, 4x, 8x) is built in
+// prepare(), so setFactor() on the audio thread only switches between them.
+// Factor 1 bypasses everything: the callback renders straight into the block.
+//
+// Different factors have different filter latencies. setCompensationDelay()
+// pads this section's output so every section in the mix lines up; see
+// OrchestraSynthEngine::getLatencySamples(). The output always passes
+// through the compensation line (one block copy), so a new delay just
+// crossfades to a new read position over compensationFadeSamples instead of
+// losing what is already in the line.
+//
+// prepare() on the message thread, everything else on the audio thread.
 class Oversampler
 {
 public:
-    explicit Oversampler (::Logger& loggerIn);
-    ...
-private:
-    ::Logger& logger;
-};
+    static constexpr int maxFactor = 8;
+    static constexpr int numFactors = 3; // 2x, 4x, 8x
+    static constexpr int compensationFadeSamples = 256;
+
+    Oversampler() = default;
 
     Oversampler (const Oversampler&) = delete;
     Oversampler& operator= (const Oversampler&) = delete;
     Oversampler (Oversampler&&) = delete;
     Oversampler& operator= (Oversampler&&) = delete;
 
-    void prepare (const juce::dsp::ProcessSpec& specIn)
+    // Maps SectionParams::oversampleFactor to 1, 2, 4 or 8.
+    static int factorFromParameter (float value) noexcept
     {
-        processSpec = specIn;
-
-        // We pick a fixed 2x oversampling for now (stages = 1).
-        constexpr int numChannels = 2;
-        constexpr int numStages   = 1; // 2^1 = 2x
-
-        oversampling = std::make_unique<juce::dsp::Oversampling<float>> (
-            numChannels,
-            numStages,
-            juce::dsp::Oversampling<float>::FilterType::filterHalfBandPolyphaseIIR,
-            true // useIntegerLatency
-        );
+        const auto requested = juce::jlimit (1, maxFactor, juce::roundToInt (value));
+        return juce::jmin (maxFactor, juce::nextPowerOfTwo (requested));
+    }
 
-        oversampling->initProcessing ((int) specIn.maximumBlockSize);
-        oversampling->reset();
+    void prepare (int maxBlockSize)
+    {
+        for (int i = 0; i < numFactors; ++i)
+        {
+            stages[(size_t) i] = std::make_unique<juce::dsp::Oversampling<float>> (
+                1,
+                (size_t) (i + 1), // 2^(i+1) x
+                juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR,
+                true); // integer latency, so sections can be aligned sample-exactly
+
+            stages[(size_t) i]->initProcessing ((size_t) juce::jmax (1, maxBlockSize));
+            latencies[(size_t) i] = juce::roundToInt (stages[(size_t) i]->getLatencyInSamples());
+        }
+
+        delayLine.setSize (1, getMaxLatencySamples() + juce::jmax (1, maxBlockSize));
+        factor = 1;
+        compensationDelay = 0;
+        previousCompensationDelay = 0;
+        compensationFadeRemaining = 0;
+        currentFactor.store (1, std::memory_order_relaxed);
+        reset();
 
         prepared.store (true, std::memory_order_release);
     }
 
     void reset()
     {
-        if (oversampling != nullptr)
-            oversampling->reset();
+        for (auto& stage : stages)
+            if (stage != nullptr)
+                stage->reset();
+
+        delayLine.clear();
+        delayWritePosition = 0;
+        compensationFadeRemaining = 0;
+        lineHasAudio = false;
     }
 
-    // Global enable/disable
-    void setEnabled (bool shouldEnable)
+    // Audio thread. The newly selected filters start from silence.
+    void setFactor (int newFactor) noexcept
     {
-        enabled.store (shouldEnable, std::memory_order_release);
+        newFactor = juce::jlimit (1, maxFactor, newFactor);
+        if (newFactor == factor)
+            return;
+
+        factor = newFactor;
+        if (auto* stage = getStage())
+            stage->reset();
+
+        currentFactor.store (factor, std::memory_order_relaxed);
     }
 
-    bool isEnabled() const
+    int getFactor() const noexcept { return factor; }
+
+    int getLatencySamples() const noexcept { return getLatencyForFactor (factor); }
+
+    int getLatencyForFactor (int f) const noexcept
     {
-        return enabled.load (std::memory_order_acquire);
+        switch (f)
+        {
+            case 2:  return latencies[0];
+            case 4:  return latencies[1];
+            case 8:  return latencies[2];
+            default: return 0;
+        }
     }
 
-    // In-place oversampling anti-alias:
-    // This will upsample + filter + downsample the buffer.
-    void process (juce::AudioBuffer<float>& buffer)
+    int getMaxLatencySamples() const noexcept
     {
-        if (! prepared.load (std::memory_order_acquire))
-            return;
-
-        if (! enabled.load (std::memory_order_acquire))
-            return;
+        return juce::jmax (latencies[0], latencies[1], latencies[2]);
+    }
 
-        const auto numSamples = buffer.getNumSamples();
-        if (numSamples <= 0)
+    // Extra delay (host-rate samples) added after decimation. A change
+    // crossfades from the old delay to the new one; the line keeps its contents.
+    void setCompensationDelay (int samples) noexcept
+    {
+        samples = juce::jlimit (0, getMaxLatencySamples(), samples);
+        if (samples == compensationDelay)
             return;
 
-        juce::dsp::AudioBlock<float> block (buffer);
-        auto upBlock = oversampling->processSamplesUp (block);
-
-        // If you ever insert non-linear processing, do it here on upBlock.
-        juce::ignoreUnused (upBlock);
+        previousCompensationDelay = compensationDelay;
+        compensationDelay = samples;
+        compensationFadeRemaining = lineHasAudio ? compensationFadeSamples : 0; // nothing to fade from after reset()
+    }
 
-        oversampling->processSamplesDown (block);
-        lastOversampleFactor.store (2, std::memory_order_relaxed);
+    // Renders numSamples of mono output into out (which must be cleared).
+    // render (float* buffer, int numSamples) is called once with the
+    // (cleared) oversampled buffer, or with out itself at factor 1.
+    template <typename RenderFunction>
+    void process (float* out, int numSamples, RenderFunction&& render)
+    {
+        if (auto* stage = getStage())
+        {
+            float* channels[] { out };
+            juce::dsp::AudioBlock<float> block (channels, 1, (size_t) numSamples);
+
+            // Input is silent; this only keeps the up-filter state coherent.
+            auto up = stage->processSamplesUp (block);
+            auto* upData = up.getChannelPointer (0);
+            const auto upSamples = (int) up.getNumSamples();
+
+            juce::FloatVectorOperations::clear (upData, upSamples);
+            render (upData, upSamples);
+
+            stage->processSamplesDown (block);
+        }
+        else
+        {
+            render (out, numSamples);
+        }
+
+        applyCompensationDelay (out, numSamples);
     }
 
     struct OversamplerSnapshot
     {
         bool isPrepared = false;
-        bool enabled = false;
         int factor = 1;
     };
 
@@ -100,17 +168,78 @@ private:
     {
         OversamplerSnapshot s;
         s.isPrepared = prepared.load (std::memory_order_acquire);
-        s.enabled    = enabled.load (std::memory_order_acquire);
-        s.factor     = lastOversampleFactor.load (std::memory_order_relaxed);
+        s.factor = currentFactor.load (std::memory_order_relaxed);
         return s;
     }
 
 private:
-    juce::dsp::ProcessSpec processSpec {};
-    std::unique_ptr<juce::dsp::Oversampling<float>> oversampling;
-    std::atomic<bool> prepared { false };
-    std::atomic<bool> enabled { true };
-    std::atomic<int> lastOversampleFactor { 1 };
+    juce::dsp::Oversampling<float>* getStage() const noexcept
+    {
+        switch (factor)
+        {
+            case 2:  return stages[0].get();
+            case 4:  return stages[1].get();
+            case 8:  return stages[2].get();
+            default: return nullptr;
+        }
+    }
+
+    // The line holds getMaxLatencySamples() + maxBlockSize samples, so the
+    // whole block can be written before anything up to the maximum delay
+    // behind it is read back.
+    void applyCompensationDelay (float* data, int numSamples) noexcept
+    {
+        auto* line = delayLine.getWritePointer (0);
+        const auto size = delayLine.getNumSamples();
+        jassert (numSamples + getMaxLatencySamples() <= size);
+
+        const auto start = delayWritePosition;
+        const auto firstPart = juce::jmin (numSamples, size - start);
+        juce::FloatVectorOperations::copy (line + start, data, firstPart);
+        juce::FloatVectorOperations::copy (line, data + firstPart, numSamples - firstPart);
+
+        delayWritePosition = (start + numSamples) % size;
+        lineHasAudio = true;
+
+        if (compensationDelay == 0 && compensationFadeRemaining == 0)
+            return; // data already is the output
+
+        auto read = [line, size, start] (int i, int delay)
+        {
+            auto position = start + i - delay;
+            if (position < 0)
+                position += size;
+            else if (position >= size)
+                position -= size;
+            return line[position];
+        };
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto sample = read (i, compensationDelay);
+
+            if (compensationFadeRemaining > 0)
+            {
+                const auto oldWeight = (float) compensationFadeRemaining / (float) compensationFadeSamples;
+                sample += oldWeight * (read (i, previousCompensationDelay) - sample);
+                --compensationFadeRemaining;
+            }
+
+            data[i] = sample;
+        }
+    }
+
+    std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, (size_t) numFactors> stages;
+    std::array<int, (size_t) numFactors> latencies {};
 
-    Logger& logger;
+    int factor = 1;
+    int compensationDelay = 0;
+    int previousCompensationDelay = 0; // faded out over compensationFadeRemaining samples
+    int compensationFadeRemaining = 0;
+    bool lineHasAudio = false;
+    juce::AudioBuffer<float> delayLine;
+    int delayWritePosition = 0;
+
+    std::atomic<bool> prepared { false };
+    std::atomic<int> currentFactor { 1 };
 };
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// Frequency-domain impulse response (or one segment of it, starting at
+// offsetSamples), cut into equal partitions of partitionSize samples, each
+// zero-padded to fftSize = 2 * partitionSize and transformed once up front. Immutable after create(), so one instance can
+// be shared by every convolver (and thread) that uses the same IR.
+//
+// Spectra are stored split (all real parts, then all imaginary parts) so the
+// per-block multiply-accumulate runs over contiguous float arrays.
+struct ImpulseResponseSpectra
+{
+    int partitionSize = 0;
+    int fftOrder = 0;
+    int fftSize = 0;
+    int numBins = 0;        // fftSize / 2 + 1
+    int numPartitions = 0;
+    int numChannels = 0;
+    int offsetSamples = 0;  // where this segment starts in the full IR
+    int lengthInSamples = 0;
+    double sampleRate = 0.0;
+
+    std::vector<float> data; // [channel][partition][re (numBins) | im (numBins)]
+
+    // Set instead of data when the spectra live in a memory-mapped cache file
+    // (see ImpulseResponseDiskCache); the mapping is kept alive with them.
+    std::shared_ptr<const juce::MemoryMappedFile> mapping;
+    const float* mappedData = nullptr;
+
+    int getSpectrumSize() const noexcept { return 2 * numBins; }
+
+    size_t getNumFloats() const noexcept
+    {
+        return (size_t) numChannels * (size_t) numPartitions * (size_t) getSpectrumSize();
+    }
+
+    const float* getData() const noexcept { return mappedData != nullptr ? mappedData : data.data(); }
+
+    size_t getPartitionOffset (int channel, int partition) const noexcept
+    {
+        return ((size_t) channel * (size_t) numPartitions + (size_t) partition) * (size_t) getSpectrumSize();
+    }
+
+    const float* getPartition (int channel, int partition) const noexcept
+    {
+        return getData() + getPartitionOffset (channel, partition);
+    }
+
+    // Message/background thread only: allocates and runs one FFT per partition.
+    // Transforms ir[startSample, startSample + numSamples), or to the end if numSamples < 0.
+    static std::shared_ptr<const ImpulseResponseSpectra> create (const juce::AudioBuffer<float>& ir,
+                                                                 double irSampleRate,
+                                                                 int partitionSize,
+                                                                 int startSample = 0,
+                                                                 int numSamples = -1)
+    {
+        auto spectra = std::make_shared<ImpulseResponseSpectra>();
+
+        startSample = juce::jlimit (0, ir.getNumSamples(), startSample);
+        const auto available = ir.getNumSamples() - startSample;
+        numSamples = numSamples < 0 ? available : juce::jmin (numSamples, available);
+
+        spectra->partitionSize   = juce::nextPowerOfTwo (juce::jmax (16, partitionSize));
+        spectra->fftSize         = 2 * spectra->partitionSize;
+        spectra->fftOrder        = juce::roundToInt (std::log2 ((double) spectra->fftSize));
+        spectra->numBins         = spectra->fftSize / 2 + 1;
+        spectra->numChannels     = juce::jlimit (1, 2, ir.getNumChannels());
+        spectra->offsetSamples   = startSample;
+        spectra->lengthInSamples = juce::jmax (1, numSamples);
+        spectra->numPartitions   = (spectra->lengthInSamples + spectra->partitionSize - 1) / spectra->partitionSize;
+        spectra->sampleRate      = irSampleRate;
+
+        spectra->data.assign (spectra->getNumFloats(), 0.0f);
+
+        juce::dsp::FFT fft (spectra->fftOrder);
+        std::vector<float> scratch ((size_t) spectra->fftSize * 2);
+
+        for (int ch = 0; ch < spectra->numChannels && ch < ir.getNumChannels(); ++ch)
+        {
+            const auto* src = ir.getReadPointer (ch, startSample);
+
+            for (int p = 0; p < spectra->numPartitions; ++p)
+            {
+                const auto start = p * spectra->partitionSize;
+                const auto count = juce::jmin (spectra->partitionSize, numSamples - start);
+
+                std::fill (scratch.begin(), scratch.end(), 0.0f);
+                if (count > 0)
+                    std::copy (src + start, src + start + count, scratch.begin());
+
+                fft.performRealOnlyForwardTransform (scratch.data(), true);
+                splitSpectrum (scratch.data(),
+                               spectra->data.data() + spectra->getPartitionOffset (ch, p),
+                               spectra->numBins);
+            }
+        }
+
+        return spectra;
+    }
+
+    // Interleaved (re, im) pairs -> split re[] / im[] arrays.
+    static void splitSpectrum (const float* interleaved, float* split, int numBins) noexcept
+    {
+        auto* re = split;
+        auto* im = split + numBins;
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            re[k] = interleaved[2 * k];
+            im[k] = interleaved[2 * k + 1];
+        }
+    }
+
+    // Split spectrum -> interleaved full spectrum (conjugate-symmetric upper
+    // half filled in), ready for FFT::performRealOnlyInverseTransform.
+    static void mergeSpectrum (const float* split, float* interleaved, int numBins, int fftSize) noexcept
+    {
+        const auto* re = split;
+        const auto* im = split + numBins;
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            interleaved[2 * k]     = re[k];
+            interleaved[2 * k + 1] = im[k];
+        }
+
+        for (int k = numBins; k < fftSize; ++k)
+        {
+            interleaved[2 * k]     =  re[fftSize - k];
+            interleaved[2 * k + 1] = -im[fftSize - k];
+        }
+    }
+
+    // acc += a * b, all split spectra of numBins bins.
+    static void multiplyAccumulate (const float* a, const float* b, float* acc, int numBins) noexcept
+    {
+        const auto* aRe = a;  const auto* aIm = a + numBins;
+        const auto* bRe = b;  const auto* bIm = b + numBins;
+        auto* accRe = acc;    auto* accIm = acc + numBins;
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            accRe[k] += aRe[k] * bRe[k] - aIm[k] * bIm[k];
+            accIm[k] += aRe[k] * bIm[k] + aIm[k] * bRe[k];
+        }
+    }
+};
+
+// Zero-latency uniformly partitioned convolution (overlap-add in the
+// frequency domain) for one or two channels.
+//
+// Every process() call transforms the partially filled current input block
+// and convolves it with the first partition, so output is available in the
+// same call regardless of host block size. The contribution of all older
+// blocks and later partitions (the expensive part) is accumulated once per
+// completed partition and reused until the next one.
+//
+// All buffers are allocated in the constructor; process() and reset() never
+// allocate, lock or wait. A convolver is built on a background thread and
+// handed to the audio thread whole (see ConvolutionEngine).
+class PartitionedConvolver
+{
+public:
+    PartitionedConvolver (std::shared_ptr<const ImpulseResponseSpectra> spectraIn, int numChannelsIn)
+        : spectra (std::move (spectraIn)),
+          fft (spectra->fftOrder),
+          numChannels (juce::jlimit (1, 2, numChannelsIn))
+    {
+        const auto spectrumSize = (size_t) spectra->getSpectrumSize();
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto& state = channels[(size_t) ch];
+            state.inputBlock.assign ((size_t) spectra->partitionSize, 0.0f);
+            state.fftBuffer.assign ((size_t) spectra->fftSize * 2, 0.0f);
+            state.overlap.assign ((size_t) spectra->partitionSize, 0.0f);
+            state.delayLine.assign ((size_t) spectra->numPartitions * spectrumSize, 0.0f);
+            state.history.assign (spectrumSize, 0.0f);
+            state.accumulator.assign (spectrumSize, 0.0f);
+        }
+    }
+
+    PartitionedConvolver (const PartitionedConvolver&) = delete;
+    PartitionedConvolver& operator= (const PartitionedConvolver&) = delete;
+    PartitionedConvolver (PartitionedConvolver&&) = delete;
+    PartitionedConvolver& operator= (PartitionedConvolver&&) = delete;
+
+    void reset() noexcept
+    {
+        for (auto& state : channels)
+        {
+            std::fill (state.inputBlock.begin(), state.inputBlock.end(), 0.0f);
+            std::fill (state.overlap.begin(), state.overlap.end(), 0.0f);
+            std::fill (state.delayLine.begin(), state.delayLine.end(), 0.0f);
+            std::fill (state.history.begin(), state.history.end(), 0.0f);
+        }
+
+        inputPosition = 0;
+        currentSegment = 0;
+    }
+
+    // Writes the wet signal for numSamples of input. input and output may not alias.
+    void process (const float* const* input, float* const* output, int numChannelsToProcess, int numSamples) noexcept
+    {
+        numChannelsToProcess = juce::jmin (numChannelsToProcess, numChannels);
+
+        int done = 0;
+        while (done < numSamples)
+        {
+            const auto n = juce::jmin (numSamples - done, spectra->partitionSize - inputPosition);
+            const auto startsNewBlock = inputPosition == 0;
+
+            for (int ch = 0; ch < numChannelsToProcess; ++ch)
+                processChannel (ch, input[ch] + done, output[ch] + done, n, startsNewBlock);
+
+            inputPosition += n;
+            done += n;
+
+            if (inputPosition == spectra->partitionSize)
+            {
+                inputPosition = 0;
+                currentSegment = currentSegment > 0 ? currentSegment - 1 : spectra->numPartitions - 1;
+            }
+        }
+    }
+
+    int getTailLengthSamples() const noexcept { return spectra->lengthInSamples; }
+
+    // The partially filled block is transformed on every call, so each input
+    // sample's output is written by the same process() call, whatever the
+    // partition size: no block delay.
+    int getLatencySamples() const noexcept { return 0; }
+
+    const std::shared_ptr<const ImpulseResponseSpectra>& getSpectra() const noexcept { return spectra; }
+
+private:
+    struct ChannelState
+    {
+        std::vector<float> inputBlock;   // current partition's input so far
+        std::vector<float> fftBuffer;    // 2 * fftSize, as juce::dsp::FFT requires
+        std::vector<float> overlap;      // second half of the previous block's result
+        std::vector<float> delayLine;    // input spectra of the last numPartitions blocks
+        std::vector<float> history;      // sum over partitions 1..n-1, fixed within a block
+        std::vector<float> accumulator;
+    };
+
+    void processChannel (int ch, const float* in, float* out, int n, bool startsNewBlock) noexcept
+    {
+        auto& state = channels[(size_t) ch];
+        const auto irChannel = juce::jmin (ch, spectra->numChannels - 1);
+        const auto numBins = spectra->numBins;
+        const auto spectrumSize = (size_t) spectra->getSpectrumSize();
+        const auto blockSize = spectra->partitionSize;
+
+        std::copy (in, in + n, state.inputBlock.begin() + inputPosition);
+
+        // Spectrum of the (partially filled) current block into the delay line
+        auto* fftData = state.fftBuffer.data();
+        std::copy (state.inputBlock.begin(), state.inputBlock.end(), fftData);
+        std::fill (fftData + blockSize, fftData + state.fftBuffer.size(), 0.0f);
+        fft.performRealOnlyForwardTransform (fftData, true);
+
+        auto* segment = state.delayLine.data() + (size_t) currentSegment * spectrumSize;
+        ImpulseResponseSpectra::splitSpectrum (fftData, segment, numBins);
+
+        if (startsNewBlock)
+        {
+            std::fill (state.history.begin(), state.history.end(), 0.0f);
+
+            auto index = currentSegment;
+            for (int p = 1; p < spectra->numPartitions; ++p)
+            {
+                if (++index >= spectra->numPartitions)
+                    index = 0;
+
+                ImpulseResponseSpectra::multiplyAccumulate (state.delayLine.data() + (size_t) index * spectrumSize,
+                                                            spectra->getPartition (irChannel, p),
+                                                            state.history.data(),
+                                                            numBins);
+            }
+        }
+
+        std::copy (state.history.begin(), state.history.end(), state.accumulator.begin());
+        ImpulseResponseSpectra::multiplyAccumulate (segment, spectra->getPartition (irChannel, 0), state.accumulator.data(), numBins);
+
+        ImpulseResponseSpectra::mergeSpectrum (state.accumulator.data(), fftData, numBins, spectra->fftSize);
+        fft.performRealOnlyInverseTransform (fftData);
+
+        for (int i = 0; i < n; ++i)
+            out[i] = fftData[inputPosition + i] + state.overlap[(size_t) (inputPosition + i)];
+
+        if (inputPosition + n == blockSize)
+        {
+            std::copy (fftData + blockSize, fftData + 2 * blockSize, state.overlap.begin());
+            std::fill (state.inputBlock.begin(), state.inputBlock.end(), 0.0f);
+        }
+    }
+
+    std::shared_ptr<const ImpulseResponseSpectra> spectra;
+    juce::dsp::FFT fft;
+    int numChannels = 2;
+
+    std::array<ChannelState, 2> channels;
+    int inputPosition = 0;
+    int currentSegment = 0;
+};
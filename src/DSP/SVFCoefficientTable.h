@@ -0,0 +1,77 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cmath>
+
+// TPT state-variable filter coefficients without std::tan.
+//
+// The prewarped gain g = tan(pi * fc / fs) is read from a table of
+// tan(pi * x) / x over normalised cutoff x in [0, maxNormalisedCutoff],
+// linearly interpolated and multiplied back by x. That ratio is smooth
+// (pi at DC, rising towards the Nyquist pole); its curvature peaks at the
+// top of the range, where 2048 points keep the error in g under 0.014 %
+// (worst case, at 0.49 fs; the cutoff error is smaller still). The table is
+// normalised, so one process-wide instance serves every sample rate and
+// oversampling factor.
+//
+// Resonance enters as r2 = 1 / Q and h = 1 / (1 + r2 g + g^2), which are
+// two divides; only the transcendental is tabled.
+class SVFCoefficientTable
+{
+public:
+    static constexpr int tableSize = 2048;
+    static constexpr float maxNormalisedCutoff = 0.49f;
+
+    struct Coefficients
+    {
+        float g = 0.0f, r2 = 1.0f, h = 1.0f;
+    };
+
+    // Built on first use; call once from prepare() so that is not the audio thread.
+    static const SVFCoefficientTable& getInstance()
+    {
+        static const SVFCoefficientTable table;
+        return table;
+    }
+
+    SVFCoefficientTable (const SVFCoefficientTable&) = delete;
+    SVFCoefficientTable& operator= (const SVFCoefficientTable&) = delete;
+    SVFCoefficientTable (SVFCoefficientTable&&) = delete;
+    SVFCoefficientTable& operator= (SVFCoefficientTable&&) = delete;
+
+    // tan(pi * normalisedCutoff), normalisedCutoff clamped to [0, maxNormalisedCutoff].
+    float getG (float normalisedCutoff) const noexcept
+    {
+        const auto x = juce::jlimit (0.0f, maxNormalisedCutoff, normalisedCutoff);
+        const auto position = x * ((float) tableSize / maxNormalisedCutoff);
+        const auto index = juce::jmin (tableSize - 1, (int) position);
+        const auto frac = position - (float) index;
+
+        const auto ratio = ratios[(size_t) index] + (ratios[(size_t) index + 1] - ratios[(size_t) index]) * frac;
+        return x * ratio;
+    }
+
+    Coefficients get (float cutoffHz, float resonance, double sampleRate) const noexcept
+    {
+        Coefficients c;
+        c.g  = getG ((float) (cutoffHz / sampleRate));
+        c.r2 = 1.0f / juce::jmax (0.05f, resonance);
+        c.h  = 1.0f / (1.0f + c.r2 * c.g + c.g * c.g);
+        return c;
+    }
+
+private:
+    SVFCoefficientTable()
+    {
+        ratios[0] = juce::MathConstants<float>::pi; // limit of tan(pi x) / x at 0
+
+        for (int i = 1; i < (int) ratios.size(); ++i)
+        {
+            const auto x = (double) maxNormalisedCutoff * i / tableSize;
+            ratios[(size_t) i] = (float) (std::tan (juce::MathConstants<double>::pi * x) / x);
+        }
+    }
+
+    std::array<float, (size_t) tableSize + 1> ratios {};
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+
+// Section-bus drive / saturation, run inside the section's Oversampler so
+// the harmonics it adds above the host Nyquist are filtered out on the way
+// down instead of folding back. One instance per section, so the cost is
+// per bus, not per voice.
+//
+// Shapes (u = input * drive gain):
+//   Tanh   symmetric soft clip, Pade approximant u (27 + u^2) / (27 + 9 u^2),
+//          reaching exactly +-1 (with zero slope) at the +-3 clamp points
+//   Tube   the same curve biased off centre: softer on one side, adds even
+//          harmonics
+//   Blare  cubic soft clip with an even-order term, for brassy rasp
+//
+// The shaper runs on juce::dsp::SIMDRegister lanes over an aligned scratch
+// block; SIMDRegister has no divide, so the Pade quotient is a short
+// per-lane loop the compiler vectorises. Asymmetric shapes are followed by
+// a 10 Hz DC blocker. With mode Off or zero drive, process() returns at once;
+// the shaped signal is crossfaded in over the first fadeInDrive of the drive
+// range, so engaging it is click-free.
+//
+// prepare() on the message thread, everything else on the audio thread.
+class SectionSaturator
+{
+public:
+    enum class Mode { Off = 0, Tanh, Tube, Blare, numModes };
+
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr int laneWidth = (int) Vec::size();
+    static constexpr int scratchSize = 64;
+    static constexpr float maxDriveDb = 24.0f;
+    static constexpr double dcBlockerHz = 10.0;
+    static constexpr double smoothingSeconds = 0.02;
+    static constexpr float fadeInDrive = 0.1f;
+
+    SectionSaturator() = default;
+
+    SectionSaturator (const SectionSaturator&) = delete;
+    SectionSaturator& operator= (const SectionSaturator&) = delete;
+    SectionSaturator (SectionSaturator&&) = delete;
+    SectionSaturator& operator= (SectionSaturator&&) = delete;
+
+    static Mode modeFromParameter (int value) noexcept
+    {
+        return static_cast<Mode> (juce::jlimit (0, (int) Mode::numModes - 1, value));
+    }
+
+    void prepare (double sampleRate)
+    {
+        setSampleRate (sampleRate);
+        driveAmount.setCurrentAndTargetValue (driveAmount.getTargetValue());
+        reset();
+    }
+
+    // Rate the data passed to process() runs at (host rate x oversampling).
+    void setSampleRate (double sampleRate) noexcept
+    {
+        driveAmount.reset (sampleRate, smoothingSeconds);
+        dcCoefficient = (float) std::exp (-juce::MathConstants<double>::twoPi * dcBlockerHz / sampleRate);
+    }
+
+    void reset() noexcept
+    {
+        dcInput = 0.0f;
+        dcOutput = 0.0f;
+    }
+
+    // drive 0..1 maps to 0..maxDriveDb of gain into the shaper; half of that
+    // gain (in dB) is taken back off the output.
+    void setParameters (Mode newMode, float drive, bool immediate) noexcept
+    {
+        drive = juce::jlimit (0.0f, 1.0f, drive);
+
+        if (newMode != mode)
+            reset();
+
+        mode = newMode;
+
+        if (immediate)
+            driveAmount.setCurrentAndTargetValue (drive);
+        else
+            driveAmount.setTargetValue (drive);
+    }
+
+    bool isActive() const noexcept
+    {
+        return mode != Mode::Off && (driveAmount.getTargetValue() > 0.0f || driveAmount.isSmoothing());
+    }
+
+    void process (float* data, int numSamples) noexcept
+    {
+        if (! isActive())
+            return;
+
+        for (int offset = 0; offset < numSamples; offset += scratchSize)
+        {
+            const auto n = juce::jmin (scratchSize, numSamples - offset);
+
+            // Drive ramps in scratch-sized steps
+            const auto drive = driveAmount.isSmoothing() ? driveAmount.skip (n) : driveAmount.getTargetValue();
+            if (drive <= 0.0f)
+                continue; // faded back to dry
+
+            const auto gain = juce::Decibels::decibelsToGain (drive * maxDriveDb);
+
+            std::copy (data + offset, data + offset + n, scratch);
+            std::fill (scratch + n, scratch + scratchSize, 0.0f);
+
+            shapeBlock (gain, 1.0f / std::sqrt (gain), juce::jmin (1.0f, drive / fadeInDrive));
+
+            if (mode == Mode::Tanh)
+            {
+                std::copy (scratch, scratch + n, data + offset);
+                continue;
+            }
+
+            for (int i = 0; i < n; ++i)
+            {
+                const auto x = scratch[i];
+                dcOutput = x - dcInput + dcCoefficient * dcOutput;
+                dcInput = x;
+                data[offset + i] = dcOutput;
+            }
+        }
+    }
+
+private:
+    static constexpr float tubeBias = 0.3f;
+    static constexpr float blareEven = 0.2f;
+
+    // u (27 + u^2) / (27 + 9 u^2) for each lane of u, clamped to +-3.
+    static Vec padeTanh (Vec u) noexcept
+    {
+        u = Vec::min (Vec::max (u, Vec::expand (-3.0f)), Vec::expand (3.0f));
+        const auto u2 = u * u;
+        const auto num = u * (u2 + 27.0f);
+        const auto den = u2 * 9.0f + 27.0f;
+
+        alignas (64) float n[(size_t) laneWidth];
+        alignas (64) float d[(size_t) laneWidth];
+        num.copyToRawArray (n);
+        den.copyToRawArray (d);
+
+        for (int l = 0; l < laneWidth; ++l)
+            n[l] /= d[l];
+
+        return Vec::fromRawArray (n);
+    }
+
+    static float padeTanh (float u) noexcept
+    {
+        u = juce::jlimit (-3.0f, 3.0f, u);
+        return u * (27.0f + u * u) / (27.0f + 9.0f * u * u);
+    }
+
+    void shapeBlock (float gain, float makeup, float mix) noexcept
+    {
+        const auto tubeOffset = Vec::expand (padeTanh (tubeBias));
+
+        for (int i = 0; i < scratchSize; i += laneWidth)
+        {
+            const auto dry = Vec::fromRawArray (scratch + i);
+            const auto u = dry * gain;
+            Vec y;
+
+            switch (mode)
+            {
+                case Mode::Tanh:
+                    y = padeTanh (u);
+                    break;
+
+                case Mode::Tube:
+                    y = padeTanh (u + tubeBias) - tubeOffset;
+                    break;
+
+                case Mode::Blare:
+                {
+                    const auto w = Vec::min (Vec::max (u, Vec::expand (-1.0f)), Vec::expand (1.0f));
+                    const auto w2 = w * w;
+                    y = w * (Vec::expand (1.5f) - w2 * 0.5f) + w2 * blareEven;
+                    break;
+                }
+
+                case Mode::Off:
+                case Mode::numModes:
+                default:
+                    y = u;
+                    break;
+            }
+
+            (dry + (y * makeup - dry) * mix).copyToRawArray (scratch + i);
+        }
+    }
+
+    Mode mode = Mode::Off;
+    juce::SmoothedValue<float> driveAmount { 0.0f };
+
+    float dcCoefficient = 0.999f;
+    float dcInput = 0.0f;
+    float dcOutput = 0.0f;
+
+    alignas (64) float scratch[(size_t) scratchSize] {};
+};
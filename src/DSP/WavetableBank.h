@@ -0,0 +1,150 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cmath>
+#include <vector>
+
+// Shared band-limited wavetable set, mip-mapped per octave.
+//
+// Tables are built once per sample rate in prepare() (message thread) and are
+// read-only afterwards, so any number of voices can share one bank. Each mip
+// level keeps only the partials that stay below Nyquist for the highest
+// fundamental of its octave, which removes aliasing without per-voice work.
+//
+// Reading uses linear interpolation over tableSize points. For the current
+// sine-based voice timbre the worst-case deviation from std::sin is below
+// maxSineDeviation (~ -114 dBFS), well under the 24-bit noise floor. The
+// interpolation error is checked at compile time and, in debug builds, the
+// built pure-sine table is measured against std::sin.
+class WavetableBank
+{
+public:
+    static constexpr int tableSize = 2048;           // power of two, + 1 guard point
+    static constexpr int numLevels = 11;             // one table per octave
+    static constexpr double lowestFundamental = 8.1758; // MIDI note 0
+    static constexpr float maxSineDeviation = 2.0e-6f;
+
+    // Linear interpolation error of sin is at most step^2 / 8 (~1.2e-6 here);
+    // float rounding on top of it is covered by the debug check in buildTables().
+    static constexpr double interpolationStep = juce::MathConstants<double>::twoPi / tableSize;
+    static_assert (interpolationStep * interpolationStep / 8.0 < (double) maxSineDeviation,
+                   "tableSize too small for maxSineDeviation");
+
+    WavetableBank() = default;
+
+    WavetableBank (const WavetableBank&) = delete;
+    WavetableBank& operator= (const WavetableBank&) = delete;
+    WavetableBank (WavetableBank&&) = delete;
+    WavetableBank& operator= (WavetableBank&&) = delete;
+
+    // Partial amplitudes, index 0 = fundamental. Defaults to a pure sine.
+    void setPartials (std::vector<float> newPartials)
+    {
+        partials = std::move (newPartials);
+
+        if (sampleRate > 0.0)
+            buildTables();
+    }
+
+    void prepare (double newSampleRate)
+    {
+        if (newSampleRate <= 0.0)
+            newSampleRate = 44100.0;
+
+        if (juce::approximatelyEqual (newSampleRate, sampleRate) && ! tables.empty())
+            return;
+
+        sampleRate = newSampleRate;
+        buildTables();
+    }
+
+    double getSampleRate() const noexcept { return sampleRate; }
+
+    // Mip level whose partials are all below Nyquist for this fundamental.
+    int getLevelForFrequency (double frequencyHz) const noexcept
+    {
+        if (frequencyHz <= lowestFundamental * 2.0)
+            return 0;
+
+        const auto level = (int) std::floor (std::log2 (frequencyHz / lowestFundamental));
+        return juce::jlimit (0, numLevels - 1, level);
+    }
+
+    const float* getTable (int level) const noexcept
+    {
+        return tables.data() + (size_t) juce::jlimit (0, numLevels - 1, level) * (size_t) (tableSize + 1);
+    }
+
+    // phase is normalised to [0, 1).
+    static float read (const float* table, float phase) noexcept
+    {
+        const auto pos  = phase * (float) tableSize;
+        const auto idx  = (int) pos;
+        const auto frac = pos - (float) idx;
+        const auto a = table[idx];
+        return a + frac * (table[idx + 1] - a);
+    }
+
+private:
+    void buildTables()
+    {
+        tables.assign ((size_t) numLevels * (size_t) (tableSize + 1), 0.0f);
+
+        const auto nyquist = sampleRate * 0.5;
+
+        for (int level = 0; level < numLevels; ++level)
+        {
+            auto* table = tables.data() + (size_t) level * (size_t) (tableSize + 1);
+
+            // Highest fundamental this octave will be asked to play.
+            const auto topFundamental = lowestFundamental * std::pow (2.0, level + 1);
+
+            for (size_t h = 0; h < partials.size(); ++h)
+            {
+                const auto harmonic = (double) (h + 1);
+                if (harmonic * topFundamental >= nyquist && h > 0)
+                    break;
+
+                const auto amp = (double) partials[h];
+                if (amp == 0.0)
+                    continue;
+
+                for (int i = 0; i < tableSize; ++i)
+                {
+                    const auto x = juce::MathConstants<double>::twoPi * harmonic * (double) i / (double) tableSize;
+                    table[i] += (float) (amp * std::sin (x));
+                }
+            }
+
+            table[tableSize] = table[0];
+        }
+
+       #if JUCE_DEBUG
+        if (partials.size() == 1 && partials[0] == 1.0f)
+            jassert (measureSineDeviation() <= maxSineDeviation);
+       #endif
+    }
+
+    // Worst |read - sin| over level 0, probed at every table point and
+    // between points, where the interpolation error peaks.
+    float measureSineDeviation() const
+    {
+        const auto* table = getTable (0);
+        constexpr int probesPerPoint = 4;
+        double worst = 0.0;
+
+        for (int i = 0; i < tableSize * probesPerPoint; ++i)
+        {
+            const auto phase = (float) i / (float) (tableSize * probesPerPoint);
+            const auto expected = std::sin (juce::MathConstants<double>::twoPi * (double) phase);
+            worst = juce::jmax (worst, std::abs ((double) read (table, phase) - expected));
+        }
+
+        return (float) worst;
+    }
+
+    double sampleRate = 0.0;
+    std::vector<float> partials { 1.0f };
+    std::vector<float> tables;
+};
@@ -6,6 +6,13 @@
 #include <cmath>
 
 #include "../DSP/Oversampler.h"
+#include "../DSP/SectionSaturator.h"
+#include "../DSP/WavetableBank.h"
+#include "SectionVoiceBank.h"
+#include "SectionRenderPool.h"
+#include "VersionedParamStore.h"
+#include "SectionMidiQueue.h"
+#include "VirtualMidiQueue.h"
 #include "../DSP/ConvolutionEngine.h"
 #include "../DSP/ImpulseResponseLoader.h"
 #include "../Systems/PresetManager.h"
@@ -16,12 +23,22 @@ class OrchestraSynthEngine
 {
 public:
     static constexpr int numSections = 5;
+    static_assert (numSections <= PerformanceMonitor::maxSections, "PerformanceMonitor has a stage slot per section");
     enum SectionIndex { Strings = 0, Brass, Woodwinds, Percussion, Choir };
 
     // Global articulation definitions: indices 0..(numArticulations-1)
     static constexpr int numArticulations = 3;
     static constexpr int articulationKeyswitchBaseNote = 24; // C1..E1 map to articulations 0..2
 
+    // SectionParams::resonance at which articulation resonances are used unscaled
+    static constexpr float referenceResonance = 0.7f;
+
+    // Per-section MIDI queue size; events past this in one block are dropped and counted
+    static constexpr int defaultMidiQueueCapacity = 16384;
+
+    // Voices preallocated per section; SectionParams::maxVoices is clamped to it
+    static constexpr int defaultVoiceCeiling = 64;
+
     // Per-section, user-facing parameters
     struct SectionParams
     {
@@ -37,7 +54,10 @@ public:
         float reverbSend = 0.3f;
         float oversampleFactor = 2.0f;
 
-        int   maxVoices = 32;       // per-section allocation
+        float drive = 0.0f;         // 0..1, saturation into the oversampled bus
+        int   saturationMode = 0;   // SectionSaturator::Mode: 0 off, 1 tanh, 2 tube, 3 blare
+
+        int   maxVoices = 32;       // polyphony limit, live, up to the voice ceiling
         int   articulationIndex = 0; // current articulation 0..numArticulations-1
     };
 
@@ -45,6 +65,7 @@ public:
     {
         SectionParams params;
         int activeVoices = 0;
+        std::uint32_t paramsVersion = 0; // changes whenever params are stored
     };
 
     OrchestraSynthEngine (PresetManager& presetManagerIn,
@@ -54,14 +75,19 @@ public:
           perfMon (perfMonIn),
           logger (loggerIn),
           convolutionReverb (loggerIn),
-          oversampler (loggerIn)
+          renderPool (loggerIn)
     {
         // Distribute 176 voices across 5 sections: 48 + 4*32
-        sectionParams[Strings].maxVoices    = 48;
-        sectionParams[Brass].maxVoices      = 32;
-        sectionParams[Woodwinds].maxVoices  = 32;
-        sectionParams[Percussion].maxVoices = 32;
-        sectionParams[Choir].maxVoices      = 32;
+        for (int sec = 0; sec < numSections; ++sec)
+        {
+            SectionParams p;
+            p.maxVoices = (sec == Strings) ? 48 : 32;
+            sectionParams[sec].store (p);
+            audioParamVersions[sec] = sectionParams[sec].load (audioParams[sec]);
+        }
+
+        for (int ch = 0; ch < 16; ++ch)
+            channelToSection[(size_t) ch].store (ch < numSections ? ch : -1, std::memory_order_relaxed);
 
         initialiseArticulations();
     }
@@ -84,86 +110,266 @@ public:
         spec.numChannels = 2;
 
         convolutionReverb.prepare (spec);
-        oversampler.prepare (spec);
+        wavetables.prepare (sampleRate);
 
         internalSampleRate.store (sampleRate, std::memory_order_release);
+        perfMon.setSampleRate (sampleRate);
 
-        // Prepare per-section synthesisers and voices
+        // Prepare per-section voice banks
         for (int sec = 0; sec < numSections; ++sec)
         {
             auto& runtime = sectionRuntime[sec];
+            runtime.voices.prepare (sampleRate, voiceCeiling, wavetables);
+            runtime.bus.setSize (2, samplesPerBlock);
+            runtime.midiQueue.prepare (midiQueueCapacity);
+            runtime.oversampler.prepare (samplesPerBlock);
+            runtime.saturator.prepare (sampleRate);
 
-            runtime.synth.clearVoices();
-            runtime.synth.clearSounds();
-            runtime.synth.setNoteStealingEnabled (true);
-            runtime.synth.setCurrentPlaybackSampleRate (sampleRate);
-
-            const auto voicesForSection = sectionParams[(SectionIndex)sec].maxVoices;
-
-            for (int v = 0; v < voicesForSection; ++v)
+            for (int art = 0; art < numArticulations; ++art)
             {
-                runtime.synth.addVoice (new SectionVoice ((SectionIndex) sec,
-                                                          sectionParams,
-                                                          sectionRuntime));
+                const auto& a = runtime.articulations[(size_t) art];
+                runtime.voices.setFilterSlot (art, a.filterCutoff, a.filterResonance);
+                runtime.voices.setEnvelopeSlot (art, a.attackMs * 0.001f, a.decayMs * 0.001f,
+                                                a.sustain, a.releaseMs * 0.001f);
             }
 
-            runtime.synth.addSound (new SectionSound ((SectionIndex) sec));
+            runtime.busGainLeft.reset (sampleRate, SectionVoiceBank::modulationSmoothingSeconds);
+            runtime.busGainRight.reset (sampleRate, SectionVoiceBank::modulationSmoothingSeconds);
+            runtime.reverbSendGain.reset (sampleRate, SectionVoiceBank::modulationSmoothingSeconds);
+
+            audioParamVersions[sec] = sectionParams[sec].load (audioParams[sec]);
+            runtime.voices.setVoiceLimit (audioParams[sec].maxVoices);
+            applySectionModulation (sec, true);
+            applyOversamplingFactor (sec);
         }
 
+        updateLatencyCompensation();
+
+        reverbSendBus.setSize (2, samplesPerBlock);
+
         lastBlockSize.store (samplesPerBlock, std::memory_order_release);
     }
 
     void reset()
     {
         convolutionReverb.reset();
-        oversampler.reset();
 
         for (int sec = 0; sec < numSections; ++sec)
-            sectionRuntime[sec].synth.allNotesOff (0, false);
+        {
+            sectionRuntime[sec].voices.allNotesOff (false);
+            sectionRuntime[sec].oversampler.reset();
+            sectionRuntime[sec].saturator.reset();
+        }
     }
 
-    // MIDI is routed deterministically to sections based on channel:
+    // MIDI is routed to sections through a channel routing table, by default:
     //   ch 1 -> Strings, 2 -> Brass, 3 -> Woodwinds, 4 -> Percussion, 5 -> Choir
-    // Articulation keyswitches: on each section's channel,
+    // (see setChannelRouting). Articulation keyswitches: on each section's channel,
     //   note 24/25/26 select articulation 0/1/2 for that section.
     void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
     {
         const auto numSamples = buffer.getNumSamples();
         perfMon.beginBlock();
 
-        splitMidiBySection (midi, numSamples);
+        {
+            ORCHESTRASYNTH_TIME_STAGE (perfMon, PullParams);
+            pullSectionParams();
+        }
+
+        {
+            ORCHESTRASYNTH_TIME_STAGE (perfMon, RouteMidi);
+            splitMidiBySection (midi, numSamples);
+            drainVirtualMidi (numSamples);
+        }
+
+        if (const auto dropped = getDroppedMidiEventCount(); dropped != reportedDroppedMidi)
+        {
+            if (dropped > reportedDroppedMidi)
+                logger.logDeferred (Logger::LogLevel::Warning, "{} MIDI event(s) dropped (queue full)",
+                                    dropped - reportedDroppedMidi);
+            reportedDroppedMidi = dropped;
+        }
+
+        perfMon.getTraceRecorder().counter ("midi", { "events" }, { lastMidiCount.load (std::memory_order_relaxed) });
+
         buffer.clear();
 
-        // Oversampling wrapper and rendering
-        oversampler.beginOversampledBlock (buffer);
+        {
+            ORCHESTRASYNTH_TIME_STAGE (perfMon, RenderSections);
+            renderSections (numSamples);
+        }
+
+        // Fixed Strings..Choir summation order, identical in serial and parallel mode.
+        // Dry buses go straight to the output; the reverb only hears the sends.
+        bool anySend = false;
 
-        for (int sec = 0; sec < numSections; ++sec)
         {
-            auto& runtime = sectionRuntime[sec];
-            auto& secBuffer = buffer; // direct mix; each synth adds into buffer
+            ORCHESTRASYNTH_TIME_STAGE (perfMon, MixBuses);
+            reverbSendBus.setSize (2, numSamples, false, false, true);
+            reverbSendBus.clear();
+
+            for (int sec = 0; sec < numSections; ++sec)
+            {
+                if (! sectionRuntime[sec].busActive)
+                    continue;
 
-            runtime.synth.renderNextBlock (secBuffer,
-                                           sectionRuntime[sec].midiBuffer,
-                                           0,
-                                           numSamples);
+                const auto& bus = sectionRuntime[sec].bus;
+                for (int ch = 0; ch < juce::jmin (buffer.getNumChannels(), bus.getNumChannels()); ++ch)
+                    buffer.addFrom (ch, 0, bus, ch, 0, numSamples);
+
+                anySend |= addToReverbSend (sec, numSamples);
+            }
+        }
+
+        {
+            ORCHESTRASYNTH_TIME_STAGE (perfMon, Reverb);
+            convolutionReverb.process (reverbSendBus, buffer, ! anySend);
         }
 
-        convolutionReverb.process (buffer);
-        oversampler.endOversampledBlock (buffer);
+        int activeVoices = 0;
+        for (const auto& runtime : sectionRuntime)
+            activeVoices += runtime.voices.getNumActiveVoices();
+
+        perfMon.endBlock (buffer.getNumSamples(), activeVoices);
+    }
+
+    // Output delay in samples caused by section oversampling: the latency of
+    // the highest factor in use (every other section is padded to match).
+    // Changes when a section's oversampleFactor does.
+    int getLatencySamples() const noexcept
+    {
+        return latencySamples.load (std::memory_order_relaxed);
+    }
+
+    // Loads a reverb impulse response (WAV/AIFF/FLAC...). Returns immediately;
+    // the IR is prepared in the background and crossfaded in when ready.
+    void loadImpulseResponse (const juce::File& file)
+    {
+        convolutionReverb.loadImpulseResponse (file);
+    }
+
+    void setReverbWetLevel (float wetLevel)
+    {
+        convolutionReverb.setWetLevel (wetLevel);
+    }
+
+    // Offline bounces wait for the reverb's background tail blocks instead of
+    // dropping late ones; any thread.
+    void setNonRealtime (bool isNonRealtime) noexcept
+    {
+        convolutionReverb.setNonRealtime (isNonRealtime);
+    }
+
+    // Reverb partition layout, latency and per-stage CPU; any thread.
+    ConvolutionEngine::ReverbSnapshot getReverbSnapshot() const
+    {
+        return convolutionReverb.getSnapshot();
+    }
+
+    // Level below which release tails are cut, idle sections are skipped and the
+    // reverb is bypassed once its tail has died away. Default -96 dB.
+    void setSilenceThresholdDb (float thresholdDb)
+    {
+        silenceThresholdDb.store (juce::jlimit (-160.0f, -30.0f, thresholdDb), std::memory_order_release);
+    }
+
+    float getSilenceThresholdDb() const
+    {
+        return silenceThresholdDb.load (std::memory_order_acquire);
+    }
+
+    // Routes a MIDI channel (1..16) to a section, or ignores it with sectionIndex = -1.
+    // Safe to call while audio is running; takes effect on the next block.
+    void setChannelRouting (int midiChannel, int sectionIndex)
+    {
+        if (midiChannel < 1 || midiChannel > 16)
+            return;
+
+        const auto target = (sectionIndex >= 0 && sectionIndex < numSections) ? sectionIndex : -1;
+        channelToSection[(size_t) (midiChannel - 1)].store (target, std::memory_order_release);
+    }
+
+    int getChannelRouting (int midiChannel) const
+    {
+        if (midiChannel < 1 || midiChannel > 16)
+            return -1;
+
+        return channelToSection[(size_t) (midiChannel - 1)].load (std::memory_order_acquire);
+    }
+
+    // Per-section queue capacity used by the next prepare().
+    void setMidiQueueCapacity (int eventsPerSection)
+    {
+        midiQueueCapacity = juce::jmax (16, eventsPerSection);
+    }
+
+    // Voices preallocated per section by the next prepare(). Per-section
+    // maxVoices then changes live, without allocation, anywhere up to it.
+    void setVoiceCeiling (int voicesPerSection)
+    {
+        voiceCeiling = juce::jmax (1, voicesPerSection);
+    }
 
-        perfMon.endBlock (buffer.getNumSamples());
+    int getVoiceCeiling() const noexcept { return voiceCeiling; }
+
+    // Injects MIDI from a non-audio thread (on-screen keyboard, mixer pads).
+    // Never blocks. The event is routed like host MIDI and is placed in the
+    // next block at the offset matching when it was posted, so UI notes get a
+    // constant one-block latency instead of landing on sample 0.
+    void postVirtualMidiMessage (const juce::MidiMessage& message)
+    {
+        const auto size = message.getRawDataSize();
+        if (size < 1 || size > 3)
+            return;
+
+        virtualMidi.push (message.getRawData(), size, juce::Time::getMillisecondCounterHiRes());
     }
 
+    // Total MIDI events dropped because a section queue or the virtual MIDI queue was full.
+    std::uint64_t getDroppedMidiEventCount() const
+    {
+        std::uint64_t total = virtualMidi.getDroppedCount();
+        for (const auto& runtime : sectionRuntime)
+            total += runtime.midiQueue.getOverflowCount();
+        return total;
+    }
+
+    // Opt-in multi-core rendering: each section renders on a pre-spawned
+    // real-time worker (or the audio thread) into its own bus.
+    // numWorkerThreads < 0 uses one less than the core count, at most numSections - 1.
+    void setParallelRenderingEnabled (bool shouldEnable, int numWorkerThreads = -1)
+    {
+        parallelRendering.store (false, std::memory_order_release);
+        renderPool.stop();
+
+        if (! shouldEnable)
+            return;
+
+        if (numWorkerThreads < 0)
+            numWorkerThreads = juce::jmin (numSections - 1, juce::SystemStats::getNumCpus() - 1);
+
+        renderPool.start (numWorkerThreads);
+        parallelRendering.store (true, std::memory_order_release);
+    }
+
+    bool isParallelRenderingEnabled() const
+    {
+        return parallelRendering.load (std::memory_order_acquire);
+    }
+
+    // Message thread (or any non-audio thread). Lock-free for the audio thread,
+    // which picks the new values up at the start of its next block.
     void setSectionParams (SectionIndex index, const SectionParams& params)
     {
-        sectionParams[index] = params;
+        sectionParams[index].store (params);
     }
 
+    // Any thread; always returns a consistent SectionParams.
     SectionStateSnapshot getSectionSnapshot (SectionIndex index) const
     {
         SectionStateSnapshot s;
-        s.params = sectionParams[index];
-        s.activeVoices = sectionRuntime[(int) index].synth.getNumActiveVoices();
+        s.paramsVersion = sectionParams[index].load (s.params);
+        s.activeVoices = sectionRuntime[(int) index].voices.getNumActiveVoices();
         return s;
     }
 
@@ -194,7 +400,7 @@ public:
             }
 
             auto sectionTree = juce::ValueTree (juce::Identifier (sectionName));
-            const auto& p = sectionParams[(SectionIndex)sec];
+            const auto p = sectionParams[sec].load();
 
             sectionTree.setProperty (juce::Identifier ("maxVoices"),       p.maxVoices, nullptr);
             sectionTree.setProperty (juce::Identifier ("gain"),            p.gain, nullptr);
@@ -205,6 +411,8 @@ public:
             sectionTree.setProperty (juce::Identifier ("releaseMs"),       p.releaseMs, nullptr);
             sectionTree.setProperty (juce::Identifier ("reverbSend"),      p.reverbSend, nullptr);
             sectionTree.setProperty (juce::Identifier ("oversampleFactor"),p.oversampleFactor, nullptr);
+            sectionTree.setProperty (juce::Identifier ("drive"),           p.drive, nullptr);
+            sectionTree.setProperty (juce::Identifier ("saturationMode"),  p.saturationMode, nullptr);
             sectionTree.setProperty (juce::Identifier ("articulationIndex"),p.articulationIndex, nullptr);
 
             dest.addChild (sectionTree, -1, nullptr);
@@ -219,7 +427,7 @@ public:
             if (! t.isValid())
                 return;
 
-            auto& p = sectionParams[idx];
+            auto p = sectionParams[idx].load();
             p.maxVoices        = (int)   t.getProperty (juce::Identifier ("maxVoices"),        p.maxVoices);
             p.gain             = (float) t.getProperty (juce::Identifier ("gain"),             p.gain);
             p.pan              = (float) t.getProperty (juce::Identifier ("pan"),              p.pan);
@@ -229,7 +437,11 @@ public:
             p.releaseMs        = (float) t.getProperty (juce::Identifier ("releaseMs"),        p.releaseMs);
             p.reverbSend       = (float) t.getProperty (juce::Identifier ("reverbSend"),       p.reverbSend);
             p.oversampleFactor = (float) t.getProperty (juce::Identifier ("oversampleFactor"), p.oversampleFactor);
+            p.drive            = (float) t.getProperty (juce::Identifier ("drive"),            p.drive);
+            p.saturationMode   = (int)   t.getProperty (juce::Identifier ("saturationMode"),   p.saturationMode);
             p.articulationIndex= (int)   t.getProperty (juce::Identifier ("articulationIndex"),p.articulationIndex);
+
+            sectionParams[idx].store (p);
         };
 
         loadSection (Strings,    "strings");
@@ -244,6 +456,10 @@ private:
     // Articulation model
     // =========================================================
 
+    // Counter track names for trace capture (string literals, as TraceRecorder requires)
+    static constexpr const char* sectionTraceNames[numSections]
+        { "voices strings", "voices brass", "voices woodwinds", "voices percussion", "voices choir" };
+
     struct ArticulationParams
     {
         float attackMs = 5.0f;
@@ -257,197 +473,329 @@ private:
 
     struct SectionRuntime
     {
-        juce::Synthesiser synth;
-        juce::MidiBuffer midiBuffer;
+        SectionVoiceBank voices;
+        SectionMidiQueue midiQueue;
+        bool busActive = false; // bus holds this block's audio; false means skipped and silent
+        int tailSamplesRemaining = 0; // idle samples still rendered to flush the oversampler delay
+        juce::AudioBuffer<float> bus; // per-section scratch bus, summed in section order
+
+        // Section gain * pan, ramped per sample on the bus (shared by all voices)
+        juce::SmoothedValue<float> busGainLeft;
+        juce::SmoothedValue<float> busGainRight;
+        juce::SmoothedValue<float> reverbSendGain; // post-fader send into reverbSendBus
         std::array<ArticulationParams, numArticulations> articulations {};
         int currentArticulationIndex = 0;
+
+        Oversampler oversampler; // voices run inside it at oversampleFactor x the host rate
+        SectionSaturator saturator; // drive stage, also inside the oversampler
     };
 
-    // Nested JUCE sound describing one section
-    class SectionSound : public juce::SynthesiserSound
+    SectionVoiceBank::NoteSetup makeNoteSetup (int sec, float velocity) const
     {
-    public:
-        explicit SectionSound (SectionIndex sec) : section (sec) {}
+        const auto articulation = juce::jlimit (0, numArticulations - 1, sectionRuntime[sec].currentArticulationIndex);
+
+        // Envelope and filter slots are indexed by articulation (set up in prepare)
+        SectionVoiceBank::NoteSetup setup;
+        setup.envelopeSlot = articulation;
+        setup.filterSlot = articulation;
+        setup.gain = juce::jlimit (0.0f, 1.0f, velocity);
+        return setup;
+    }
 
-        bool appliesToNote (int) override               { return true; }
-        bool appliesToChannel (int) override            { return true; }
+    // Pushes gain/pan/cutoff/resonance of audioParams[sec] into the bus ramps
+    // and the voice bank's filter modulation. Live voices follow smoothly.
+    void applySectionModulation (int sec, bool immediate)
+    {
+        const auto& p = audioParams[sec];
+        auto& runtime = sectionRuntime[sec];
 
-        SectionIndex getSection() const noexcept        { return section; }
+        const auto pan = juce::jlimit (-1.0f, 1.0f, p.pan);
+        const auto angle = (pan + 1.0f) * juce::MathConstants<float>::halfPi * 0.5f;
+        const auto left  = p.gain * std::cos (angle);
+        const auto right = p.gain * std::sin (angle);
+        const auto send  = juce::jlimit (0.0f, 1.0f, p.reverbSend);
 
-    private:
-        SectionIndex section;
-    };
+        if (immediate)
+        {
+            runtime.busGainLeft.setCurrentAndTargetValue (left);
+            runtime.busGainRight.setCurrentAndTargetValue (right);
+            runtime.reverbSendGain.setCurrentAndTargetValue (send);
+        }
+        else
+        {
+            runtime.busGainLeft.setTargetValue (left);
+            runtime.busGainRight.setTargetValue (right);
+            runtime.reverbSendGain.setTargetValue (send);
+        }
 
-    // Voice that reads SectionParams + Articulation per section
-    class SectionVoice : public juce::SynthesiserVoice
+        runtime.voices.setFilterModulation (p.cutoff, p.resonance / referenceResonance, immediate);
+        runtime.saturator.setParameters (SectionSaturator::modeFromParameter (p.saturationMode), p.drive, immediate);
+    }
+
+    // Turns the mono section signal in bus channel 0 into the stereo bus.
+    void applyBusGainPan (int sec, int numSamples)
     {
-    public:
-        SectionVoice (SectionIndex sectionIn,
-                      std::array<SectionParams, numSections>& sectionParamsIn,
-                      std::array<SectionRuntime, numSections>& sectionRuntimeIn)
-            : section (sectionIn),
-              sectionParams (sectionParamsIn),
-              sectionRuntime (sectionRuntimeIn)
+        auto& runtime = sectionRuntime[sec];
+        auto* left  = runtime.bus.getWritePointer (0);
+        auto* right = runtime.bus.getWritePointer (1);
+
+        auto& gainL = runtime.busGainLeft;
+        auto& gainR = runtime.busGainRight;
+
+        if (! gainL.isSmoothing() && ! gainR.isSmoothing())
         {
-            updateFilterSampleRate (44100.0);
+            juce::FloatVectorOperations::multiply (right, left, gainR.getTargetValue(), numSamples);
+            juce::FloatVectorOperations::multiply (left, gainL.getTargetValue(), numSamples);
+            return;
         }
 
-        bool canPlaySound (juce::SynthesiserSound* sound) override
+        for (int n = 0; n < numSamples; ++n)
         {
-            if (auto* s = dynamic_cast<SectionSound*> (sound))
-                return s->getSection() == section;
-            return false;
+            const auto m = left[n];
+            left[n]  = m * gainL.getNextValue();
+            right[n] = m * gainR.getNextValue();
         }
+    }
 
-        void startNote (int midiNoteNumber,
-                        float velocity,
-                        juce::SynthesiserSound* /*sound*/,
-                        int /*currentPitchWheelPosition*/) override
+    // Adds the section's stereo bus to the reverb send at its send level.
+    // Returns false (and touches nothing) when the send is fully closed.
+    bool addToReverbSend (int sec, int numSamples)
+    {
+        auto& runtime = sectionRuntime[sec];
+        auto& sendGain = runtime.reverbSendGain;
+
+        if (! sendGain.isSmoothing())
         {
-            currentMidiNote = midiNoteNumber;
-            currentVelocity = velocity;
+            const auto gain = sendGain.getTargetValue();
+            if (gain <= 0.0f)
+                return false;
 
-            const auto& p = sectionParams[(int) section];
-            const auto& art = getCurrentArticulation();
+            for (int ch = 0; ch < 2; ++ch)
+                reverbSendBus.addFrom (ch, 0, runtime.bus, ch, 0, numSamples, gain);
 
-            juce::ADSR::Parameters adsrParams;
-            adsrParams.attack  = art.attackMs  * 0.001f;
-            adsrParams.decay   = art.decayMs   * 0.001f;
-            adsrParams.sustain = art.sustain;
-            adsrParams.release = art.releaseMs * 0.001f;
-            adsr.setParameters (adsrParams);
-            adsr.noteOn();
+            return true;
+        }
 
-            filter.reset();
-            setFilterParams (art.filterCutoff, art.filterResonance);
+        auto* sendL = reverbSendBus.getWritePointer (0);
+        auto* sendR = reverbSendBus.getWritePointer (1);
+        const auto* busL = runtime.bus.getReadPointer (0);
+        const auto* busR = runtime.bus.getReadPointer (1);
 
-            level = p.gain * juce::jlimit (0.0f, 1.0f, velocity);
-            updatePanGains (p.pan);
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const auto gain = sendGain.getNextValue();
+            sendL[n] += busL[n] * gain;
+            sendR[n] += busR[n] * gain;
         }
 
-        void stopNote (float /*velocity*/, bool allowTailOff) override
+        return true;
+    }
+
+    void handleSectionMidi (int sec, const SectionMidiEvent& e)
+    {
+        auto& runtime = sectionRuntime[sec];
+        auto& voices = runtime.voices;
+
+        if (e.isNoteOn())
         {
-            if (allowTailOff)
+            const int note = e.data[1];
+            const int relative = note - articulationKeyswitchBaseNote;
+
+            // Articulation keyswitches are swallowed, at their exact position
+            if (relative >= 0 && relative < numArticulations)
             {
-                adsr.noteOff();
+                runtime.currentArticulationIndex = relative;
+                return;
             }
-            else
+
+            voices.noteOn (note, makeNoteSetup (sec, (float) e.data[2] / 127.0f));
+        }
+        else if (e.isNoteOff())
+        {
+            voices.noteOff (e.data[1], true);
+        }
+        else if (e.isController())
+        {
+            switch (e.data[1])
             {
-                clearCurrentNote();
-                adsr.reset();
+                case 64:  voices.setSustainPedal (e.data[2] >= 64); break;
+                case 120: voices.allNotesOff (false); break; // all sound off
+                case 123: voices.allNotesOff (true);  break; // all notes off
+                default: break;
             }
         }
+    }
 
-        void pitchWheelMoved (int) override {}
-        void controllerMoved (int, int) override {}
+    // Renders one section's voices into mono, splitting at each MIDI event
+    // so note-ons and note-offs land on their exact sample. Inside the
+    // oversampler, mono runs at oversampling x the host rate.
+    void renderSection (int sec, float* mono, int numSamples, int oversampling)
+    {
+        auto& runtime = sectionRuntime[sec];
+
+        int pos = 0;
 
-        void renderNextBlock (juce::AudioBuffer<float>& outputBuffer,
-                              int startSample,
-                              int numSamples) override
+        for (const auto& e : runtime.midiQueue)
         {
-            if (! isVoiceActive())
-                return;
+            const auto eventPos = juce::jlimit (0, numSamples, e.samplePosition * oversampling);
 
-            tempBuffer.setSize (1, numSamples, false, false, true);
-            tempBuffer.clear();
+            if (eventPos > pos)
+            {
+                runtime.voices.render (mono + pos, eventPos - pos);
+                pos = eventPos;
+            }
 
-            auto* mono = tempBuffer.getWritePointer (0);
+            handleSectionMidi (sec, e);
+        }
 
-            const auto sampleRate = currentSampleRate > 0.0 ? currentSampleRate : 44100.0;
-            const auto freq = juce::MidiMessage::getMidiNoteInHertz (currentMidiNote);
+        if (pos < numSamples)
+            runtime.voices.render (mono + pos, numSamples - pos);
+    }
 
-            // Simple band-limited-ish waveform: sum of two detuned sines, then filtered
-            for (int n = 0; n < numSamples; ++n)
+    // Audio thread: copy section params only when their version moved.
+    void pullSectionParams()
+    {
+        for (int sec = 0; sec < numSections; ++sec)
+        {
+            const auto version = sectionParams[sec].getVersion();
+            if (version == audioParamVersions[sec])
+                continue;
+
+            const auto previousArticulation = audioParams[sec].articulationIndex;
+            audioParamVersions[sec] = sectionParams[sec].load (audioParams[sec]);
+
+            // An articulation picked in the UI or a preset behaves like a keyswitch
+            if (audioParams[sec].articulationIndex != previousArticulation)
+                sectionRuntime[sec].currentArticulationIndex
+                    = juce::jlimit (0, numArticulations - 1, audioParams[sec].articulationIndex);
+
+            applySectionModulation (sec, false);
+            sectionRuntime[sec].voices.setVoiceLimit (audioParams[sec].maxVoices);
+
+            if (applyOversamplingFactor (sec))
+                updateLatencyCompensation();
+        }
+    }
+
+    // Returns true if the section's factor changed. Switches between
+    // preallocated stages only, so it is safe on the audio thread.
+    bool applyOversamplingFactor (int sec)
+    {
+        auto& runtime = sectionRuntime[sec];
+        const auto factor = Oversampler::factorFromParameter (audioParams[sec].oversampleFactor);
+
+        if (factor == runtime.oversampler.getFactor())
+            return false;
+
+        runtime.oversampler.setFactor (factor);
+        runtime.voices.setOversamplingFactor (factor);
+        runtime.saturator.setSampleRate (internalSampleRate.load (std::memory_order_relaxed) * factor);
+        return true;
+    }
+
+    // Delays every section to the slowest one's oversampling latency.
+    void updateLatencyCompensation()
+    {
+        int maxLatency = 0;
+        for (auto& runtime : sectionRuntime)
+            maxLatency = juce::jmax (maxLatency, runtime.oversampler.getLatencySamples());
+
+        for (auto& runtime : sectionRuntime)
+            runtime.oversampler.setCompensationDelay (maxLatency - runtime.oversampler.getLatencySamples());
+
+        latencySamples.store (maxLatency, std::memory_order_relaxed);
+    }
+
+    void renderSectionToBus (int sec)
+    {
+        auto& runtime = sectionRuntime[sec];
+
+        // Nothing sounding and nothing to start: keep rendering until the
+        // latency-compensated tail has played out, then skip the section.
+        const auto idle = runtime.voices.isSilent() && runtime.midiQueue.size() == 0;
+
+        if (idle && runtime.tailSamplesRemaining <= 0)
+        {
+            // Filters and the delay line may still hold audio (e.g. after
+            // CC120); don't let it resurface on the next note-on.
+            if (runtime.busActive)
             {
-                const double t = phase / sampleRate;
-                const double x1 = std::sin (juce::MathConstants<double>::twoPi * freq * t);
-                const double x2 = std::sin (juce::MathConstants<double>::twoPi * (freq * 1.01) * t);
-                mono[n] = (float) (0.5 * (x1 + x2));
-                phase += 1.0;
+                runtime.oversampler.reset();
+                runtime.saturator.reset();
             }
 
-            juce::dsp::AudioBlock<float> block (tempBuffer);
-            juce::dsp::ProcessContextReplacing<float> ctx (block);
-            filter.process (ctx);
+            runtime.busGainLeft.skip (blockNumSamples);
+            runtime.busGainRight.skip (blockNumSamples);
+            runtime.reverbSendGain.skip (blockNumSamples);
+            runtime.busActive = false;
+            return;
+        }
+
+        runtime.tailSamplesRemaining = idle ? runtime.tailSamplesRemaining - blockNumSamples
+                                            : latencySamples.load (std::memory_order_relaxed);
 
-            adsr.applyEnvelopeToBuffer (tempBuffer, 0, numSamples);
+        ORCHESTRASYNTH_TIME_SECTION_STAGE (perfMon, Bus, sec);
 
-            if (! adsr.isActive())
+        auto& bus = runtime.bus;
+        bus.setSize (2, blockNumSamples, false, false, true);
+        bus.clear();
+
+        const auto factor = runtime.oversampler.getFactor();
+        runtime.oversampler.process (bus.getWritePointer (0), blockNumSamples, [this, &runtime, sec, factor] (float* mono, int n)
+        {
             {
-                clearCurrentNote();
-                return;
+                ORCHESTRASYNTH_TIME_SECTION_STAGE (perfMon, Voices, sec);
+                renderSection (sec, mono, n, factor);
             }
 
-            auto* left  = outputBuffer.getWritePointer (0, startSample);
-            auto* right = outputBuffer.getNumChannels() > 1
-                          ? outputBuffer.getWritePointer (1, startSample)
-                          : nullptr;
-
-            for (int n = 0; n < numSamples; ++n)
+            if (runtime.saturator.isActive())
             {
-                const float s = mono[n] * level;
-                left[n]  += s * panLeft;
-                if (right != nullptr)
-                    right[n] += s * panRight;
+                ORCHESTRASYNTH_TIME_SECTION_STAGE (perfMon, Saturation, sec);
+                runtime.saturator.process (mono, n);
             }
-        }
+        });
 
-        void setCurrentPlaybackSampleRate (double newRate) override
-        {
-            currentSampleRate = newRate;
-            updateFilterSampleRate (newRate);
-        }
+        applyBusGainPan (sec, blockNumSamples);
+        runtime.busActive = true;
 
-    private:
-        ArticulationParams getCurrentArticulation() const
-        {
-            const auto secIdx = (int) section;
-            const auto idx = juce::jlimit (0, numArticulations - 1,
-                                           sectionRuntime[secIdx].currentArticulationIndex);
-            return sectionRuntime[secIdx].articulations[(size_t) idx];
-        }
+        const auto events = runtime.voices.takeVoiceEventCounts();
+        if (events.started > 0 || events.stopped > 0)
+            perfMon.getTraceRecorder().counter (sectionTraceNames[sec], { "started", "stolen", "stopped", "active" },
+                                                { events.started, events.stolen, events.stopped,
+                                                  runtime.voices.getNumActiveVoices() });
+    }
 
-        void setFilterParams (float cutoff, float resonance)
-        {
-            auto& f = filter.state->parameters;
-            f.type = juce::dsp::StateVariableTPTFilterType::lowpass;
-            f.setCutOffFrequency (currentSampleRate, cutoff, resonance);
-        }
+    void applySilenceThreshold()
+    {
+        const auto thresholdDb = silenceThresholdDb.load (std::memory_order_relaxed);
+        if (thresholdDb == appliedSilenceThresholdDb)
+            return;
 
-        void updateFilterSampleRate (double newRate)
-        {
-            juce::dsp::ProcessSpec spec;
-            spec.sampleRate = newRate > 0.0 ? newRate : 44100.0;
-            spec.maximumBlockSize = 512;
-            spec.numChannels = 1;
-            filter.prepare (spec);
-        }
+        appliedSilenceThresholdDb = thresholdDb;
+        const auto threshold = juce::Decibels::decibelsToGain (thresholdDb);
 
-        void updatePanGains (float pan)
-        {
-            const auto p = juce::jlimit (-1.0f, 1.0f, pan);
-            const auto angle = (p + 1.0f) * juce::MathConstants<float>::halfPi * 0.5f;
-            panLeft  = std::cos (angle);
-            panRight = std::sin (angle);
-        }
+        for (auto& runtime : sectionRuntime)
+            runtime.voices.setSilenceThreshold (threshold);
 
-        SectionIndex section;
-        std::array<SectionParams, numSections>& sectionParams;
-        std::array<SectionRuntime, numSections>& sectionRuntime;
+        convolutionReverb.setSilenceThreshold (threshold);
+    }
 
-        int   currentMidiNote = 60;
-        float currentVelocity = 1.0f;
-        double currentSampleRate = 44100.0;
-        double phase = 0.0;
+    void renderSections (int numSamples)
+    {
+        blockNumSamples = numSamples;
+        applySilenceThreshold();
 
-        float level = 0.0f;
-        float panLeft = 1.0f;
-        float panRight = 1.0f;
+        if (parallelRendering.load (std::memory_order_acquire))
+        {
+            renderPool.run (numSections,
+                            [] (void* ctx, int sec) { static_cast<OrchestraSynthEngine*> (ctx)->renderSectionToBus (sec); },
+                            this);
+            return;
+        }
 
-        juce::ADSR adsr;
-        juce::dsp::StateVariableTPTFilter<float> filter;
-        juce::AudioBuffer<float> tempBuffer;
-    };
+        for (int sec = 0; sec < numSections; ++sec)
+            renderSectionToBus (sec);
+    }
 
     void initialiseArticulations()
     {
@@ -474,45 +822,59 @@ private:
         }
     }
 
+    // Routes host MIDI into the fixed-capacity section queues. Reads the raw
+    // bytes in place; neither this nor the queues touch the heap.
     void splitMidiBySection (juce::MidiBuffer& midi, int /*numSamples*/)
     {
         for (int sec = 0; sec < numSections; ++sec)
-            sectionRuntime[sec].midiBuffer.clear();
+            sectionRuntime[sec].midiQueue.clear();
 
         int eventCount = 0;
 
         for (const auto metadata : midi)
         {
-            const auto msg = metadata.getMessage();
-            const auto pos = metadata.samplePosition;
             ++eventCount;
+            routeMidiEvent (metadata.samplePosition, metadata.data, metadata.numBytes);
+        }
 
-            const int channel = msg.getChannel();
-            const int sectionIndex = channel - 1; // ch1..5 -> 0..4
+        lastMidiCount.store (eventCount, std::memory_order_relaxed);
+        midi.clear(); // consumed into per-section queues
+    }
 
-            if (sectionIndex < 0 || sectionIndex >= numSections)
-                continue;
+    // Moves virtual MIDI posted since the previous block into the section
+    // queues. An event posted t ms after the previous block started lands t ms
+    // into this one; anything older or newer than one block is clamped.
+    void drainVirtualMidi (int numSamples)
+    {
+        const auto now = juce::Time::getMillisecondCounterHiRes();
+        const auto samplesPerMs = internalSampleRate.load (std::memory_order_relaxed) * 0.001;
+        const auto windowStart = previousBlockStartMs > 0.0
+                                   ? previousBlockStartMs
+                                   : now - (double) numSamples / samplesPerMs;
+        previousBlockStartMs = now;
+
+        VirtualMidiQueue::Event e;
+        while (virtualMidi.pop (e))
+        {
+            const auto offset = (int) std::lround ((e.timestampMs - windowStart) * samplesPerMs);
+            routeMidiEvent (juce::jlimit (0, juce::jmax (0, numSamples - 1), offset), e.data, e.size);
+        }
+    }
 
-            auto& runtime = sectionRuntime[sectionIndex];
+    void routeMidiEvent (int samplePosition, const std::uint8_t* data, int numBytes)
+    {
+        if (numBytes < 1 || numBytes > 3)
+            return; // sysex / meta are not used by the sections
 
-            // Articulation keyswitch handling
-            if (msg.isNoteOn())
-            {
-                const int note = msg.getNoteNumber();
-                const int relative = note - articulationKeyswitchBaseNote;
-
-                if (relative >= 0 && relative < numArticulations)
-                {
-                    runtime.currentArticulationIndex = relative;
-                    continue; // swallow keyswitch events
-                }
-            }
+        const auto status = data[0];
+        if (status < 0x80 || status >= 0xf0)
+            return;
 
-            runtime.midiBuffer.addEvent (msg, pos);
-        }
+        const auto sectionIndex = channelToSection[(size_t) (status & 0x0f)].load (std::memory_order_relaxed);
+        if (sectionIndex < 0)
+            return;
 
-        lastMidiCount.store (eventCount, std::memory_order_relaxed);
-        midi.clear(); // consumed into per-section buffers
+        sectionRuntime[(size_t) sectionIndex].midiQueue.push (samplePosition, data, numBytes);
     }
 
     // =========================================================
@@ -524,13 +886,35 @@ private:
     Logger& logger;
 
     ConvolutionEngine convolutionReverb;
-    Oversampler oversampler;
+    juce::AudioBuffer<float> reverbSendBus; // sum of the section sends, the reverb's only input
     ImpulseResponseLoader irLoader;
+    WavetableBank wavetables;
+
+    // Written from the message thread, read consistently from anywhere
+    std::array<VersionedParamStore<SectionParams>, numSections> sectionParams;
 
-    std::array<SectionParams, numSections> sectionParams {};
+    // Audio-thread copies, refreshed in pullSectionParams()
+    std::array<SectionParams, numSections> audioParams {};
+    std::array<std::uint32_t, numSections> audioParamVersions {};
     std::array<SectionRuntime, numSections> sectionRuntime {};
 
+    SectionRenderPool renderPool;
+    std::atomic<bool> parallelRendering { false };
+    int blockNumSamples = 0;
+
     std::atomic<double> internalSampleRate { 44100.0 };
     std::atomic<int> lastBlockSize { 512 };
     std::atomic<int> lastMidiCount { 0 };
+    std::atomic<int> latencySamples { 0 };
+
+    std::array<std::atomic<int>, 16> channelToSection {};
+    int midiQueueCapacity = defaultMidiQueueCapacity;
+    int voiceCeiling = defaultVoiceCeiling;
+
+    std::atomic<float> silenceThresholdDb { -96.0f };
+    float appliedSilenceThresholdDb = 0.0f; // audio thread; 0 dB never valid, forces first apply
+
+    VirtualMidiQueue virtualMidi;
+    double previousBlockStartMs = 0.0;
+    std::uint64_t reportedDroppedMidi = 0; // audio thread
 };
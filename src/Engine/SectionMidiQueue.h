@@ -0,0 +1,90 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// One short (1..3 byte) channel-voice MIDI event at a sample offset.
+struct SectionMidiEvent
+{
+    int samplePosition = 0;
+    std::uint8_t data[3] {};
+    std::uint8_t size = 0;
+
+    std::uint8_t getStatus() const noexcept    { return (std::uint8_t) (data[0] & 0xf0); }
+    int getChannel() const noexcept            { return (data[0] & 0x0f) + 1; }
+    bool isNoteOn() const noexcept             { return getStatus() == 0x90 && data[2] != 0; }
+    bool isNoteOff() const noexcept            { return getStatus() == 0x80 || (getStatus() == 0x90 && data[2] == 0); }
+    bool isController() const noexcept         { return getStatus() == 0xb0; }
+};
+
+// Fixed-capacity, time-ordered event queue for one section.
+//
+// Storage is sized once in prepare() on the message thread; push() never
+// allocates. When a block carries more events than the queue holds, the
+// extra events are dropped and counted instead of growing the buffer, so a
+// pathological burst costs lost events rather than a heap call on the audio
+// thread.
+class SectionMidiQueue
+{
+public:
+    SectionMidiQueue() = default;
+
+    SectionMidiQueue (const SectionMidiQueue&) = delete;
+    SectionMidiQueue& operator= (const SectionMidiQueue&) = delete;
+    SectionMidiQueue (SectionMidiQueue&&) = delete;
+    SectionMidiQueue& operator= (SectionMidiQueue&&) = delete;
+
+    void prepare (int capacity)
+    {
+        events.resize ((size_t) juce::jmax (1, capacity));
+        numEvents = 0;
+    }
+
+    void clear() noexcept { numEvents = 0; }
+
+    // Inserts in sample order (stable for equal positions). Input that is
+    // already sorted, as host MIDI is, appends in O(1).
+    bool push (int samplePosition, const std::uint8_t* data, int size) noexcept
+    {
+        if (numEvents >= (int) events.size())
+        {
+            overflowCount.fetch_add (1, std::memory_order_relaxed);
+            return false;
+        }
+
+        SectionMidiEvent e;
+        e.samplePosition = samplePosition;
+        e.size = (std::uint8_t) juce::jlimit (0, 3, size);
+        for (int i = 0; i < e.size; ++i)
+            e.data[i] = data[i];
+
+        auto i = numEvents++;
+        while (i > 0 && events[(size_t) (i - 1)].samplePosition > samplePosition)
+        {
+            events[(size_t) i] = events[(size_t) (i - 1)];
+            --i;
+        }
+
+        events[(size_t) i] = e;
+        return true;
+    }
+
+    const SectionMidiEvent* begin() const noexcept { return events.data(); }
+    const SectionMidiEvent* end() const noexcept   { return events.data() + numEvents; }
+
+    int size() const noexcept     { return numEvents; }
+    int capacity() const noexcept { return (int) events.size(); }
+
+    // Events dropped since construction; readable from any thread.
+    std::uint64_t getOverflowCount() const noexcept
+    {
+        return overflowCount.load (std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<SectionMidiEvent> events;
+    int numEvents = 0;
+    std::atomic<std::uint64_t> overflowCount { 0 };
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../Systems/Logger.h"
+
+// Fixed pool of pre-spawned real-time worker threads for fork/join rendering.
+//
+// run() publishes a batch of jobs, executes jobs on the calling (audio)
+// thread alongside the workers, and returns once every job has finished.
+// Nothing on the run() path locks or allocates:
+//   - jobs are claimed through a single 64-bit atomic holding
+//     (batch generation << 32 | next job index), so a worker that wakes late
+//     can never run a job from a batch other than the one it claimed;
+//   - completion is a countdown the caller spins on;
+//   - idle workers spin briefly, then sleep on std::atomic::wait, and are
+//     only notified when at least one of them is actually asleep.
+//
+// If workers are missing or slow, the calling thread drains the remaining
+// jobs itself, so run() always completes.
+//
+// Threading: start()/stop() on the message thread, run() from one thread only.
+class SectionRenderPool
+{
+public:
+    using JobFunction = void (*) (void* context, int jobIndex);
+
+    explicit SectionRenderPool (Logger& loggerIn) : logger (loggerIn) {}
+
+    ~SectionRenderPool()
+    {
+        stop();
+    }
+
+    SectionRenderPool (const SectionRenderPool&) = delete;
+    SectionRenderPool& operator= (const SectionRenderPool&) = delete;
+    SectionRenderPool (SectionRenderPool&&) = delete;
+    SectionRenderPool& operator= (SectionRenderPool&&) = delete;
+
+    void start (int numWorkers)
+    {
+        stop();
+
+        numWorkers = juce::jmax (0, numWorkers);
+        shuttingDown.store (false, std::memory_order_release);
+
+        for (int i = 0; i < numWorkers; ++i)
+        {
+            auto worker = std::make_unique<Worker> (*this, i);
+
+            if (! worker->startRealtimeThread (juce::Thread::RealtimeOptions{}))
+            {
+                logger.log (Logger::LogLevel::Warning,
+                            "Render worker " + juce::String (i) + " could not get real-time priority");
+                worker->startThread (juce::Thread::Priority::highest);
+            }
+
+            workers.push_back (std::move (worker));
+        }
+
+        logger.log (Logger::LogLevel::Info,
+                    "Section render pool started with " + juce::String (numWorkers) + " worker(s)");
+    }
+
+    void stop()
+    {
+        if (workers.empty())
+            return;
+
+        shuttingDown.store (true, std::memory_order_release);
+
+        for (auto& w : workers)
+            w->signalThreadShouldExit();
+
+        wakeCounter.fetch_add (1, std::memory_order_release);
+        wakeCounter.notify_all();
+
+        for (auto& w : workers)
+            w->stopThread (1000);
+
+        workers.clear();
+    }
+
+    int getNumWorkers() const noexcept { return (int) workers.size(); }
+
+    // Runs fn (context, i) for every i in [0, numJobs) and waits for all of them.
+    void run (int numJobs, JobFunction fn, void* context) noexcept
+    {
+        if (numJobs <= 0)
+            return;
+
+        jobFunction.store (fn, std::memory_order_relaxed);
+        jobContext.store (context, std::memory_order_relaxed);
+        jobCount.store (numJobs, std::memory_order_relaxed);
+        pendingJobs.store (numJobs, std::memory_order_relaxed);
+
+        const auto generation = ++batchGeneration;
+        claim.store ((std::uint64_t) generation << 32, std::memory_order_release);
+
+        // seq_cst pairs with the worker's sleepingWorkers increment, so either
+        // we see the sleeper or it sees the new wake value before waiting.
+        wakeCounter.fetch_add (1);
+        if (sleepingWorkers.load() > 0)
+            wakeCounter.notify_all();
+
+        // Help out, then spin until stragglers on other threads finish.
+        while (runOneJob (generation)) {}
+
+        while (pendingJobs.load (std::memory_order_acquire) > 0)
+            std::this_thread::yield();
+    }
+
+private:
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker (SectionRenderPool& ownerIn, int index)
+            : juce::Thread ("SectionRender " + juce::String (index)),
+              owner (ownerIn)
+        {
+        }
+
+        void run() override
+        {
+            auto seenWake = owner.wakeCounter.load (std::memory_order_acquire);
+
+            while (! threadShouldExit())
+            {
+                seenWake = owner.waitForWork (seenWake);
+
+                if (owner.shuttingDown.load (std::memory_order_acquire))
+                    break;
+
+                const auto generation = (std::uint32_t) (owner.claim.load (std::memory_order_acquire) >> 32);
+                while (owner.runOneJob (generation)) {}
+            }
+        }
+
+    private:
+        SectionRenderPool& owner;
+    };
+
+    std::uint32_t waitForWork (std::uint32_t seenWake) noexcept
+    {
+        constexpr int spinIterations = 2000;
+
+        for (int i = 0; i < spinIterations; ++i)
+        {
+            const auto now = wakeCounter.load (std::memory_order_acquire);
+            if (now != seenWake)
+                return now;
+
+            std::this_thread::yield();
+        }
+
+        sleepingWorkers.fetch_add (1);
+        wakeCounter.wait (seenWake);
+        sleepingWorkers.fetch_sub (1);
+
+        return wakeCounter.load (std::memory_order_acquire);
+    }
+
+    // Claims and runs one job of the given batch; false when none are left.
+    bool runOneJob (std::uint32_t generation) noexcept
+    {
+        auto current = claim.load (std::memory_order_acquire);
+
+        for (;;)
+        {
+            if ((std::uint32_t) (current >> 32) != generation)
+                return false;
+
+            const auto index = (int) (current & 0xffffffffu);
+            if (index >= jobCount.load (std::memory_order_relaxed))
+                return false;
+
+            auto* fn  = jobFunction.load (std::memory_order_relaxed);
+            auto* ctx = jobContext.load (std::memory_order_relaxed);
+
+            if (claim.compare_exchange_weak (current, current + 1,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire))
+            {
+                fn (ctx, index);
+                pendingJobs.fetch_sub (1, std::memory_order_acq_rel);
+                return true;
+            }
+        }
+    }
+
+    Logger& logger;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::atomic<JobFunction> jobFunction { nullptr };
+    std::atomic<void*> jobContext { nullptr };
+    std::atomic<int> jobCount { 0 };
+    std::atomic<int> pendingJobs { 0 };
+    std::atomic<std::uint64_t> claim { 0 };
+    std::uint32_t batchGeneration = 0;
+
+    std::atomic<std::uint32_t> wakeCounter { 0 };
+    std::atomic<int> sleepingWorkers { 0 };
+    std::atomic<bool> shuttingDown { false };
+};
@@ -0,0 +1,835 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "../DSP/SVFCoefficientTable.h"
+#include "../DSP/WavetableBank.h"
+
+// Structure-of-arrays voice bank for one orchestral section.
+//
+// Every per-voice quantity the render loop touches (oscillator phases and
+// increments, SVF state and coefficients, envelope state, output gains) lives
+// in its own contiguous, SIMD-aligned float array. render() walks the voices
+// in lane groups of juce::dsp::SIMDRegister<float>::size() - 4 on SSE/NEON,
+// 8 on AVX builds - and runs filter, envelope and gain for the whole group in
+// one register. Only the wavetable lookup is a per-lane scalar gather.
+//
+// Signal path per voice:
+//   0.5 * (oscA + oscB) -> TPT SVF lowpass -> exponential ADSR -> velocity gain
+// summed into a mono section signal. Section gain and pan are applied once
+// to that sum by the engine, so mixer moves reach sustained notes for free.
+//
+// Filter coefficients come from a handful of shared filter slots (one per
+// articulation). Section cutoff/resonance modulation is smoothed at control
+// rate: while it ramps, each slot's coefficients are recomputed once per
+// controlBlockSize samples and copied to the voices using that slot, rather
+// than every voice computing its own. The recompute is a table lookup
+// (SVFCoefficientTable), not std::tan.
+//
+// Envelopes are exponential segments run as the one-multiply-add recurrence
+// level = level * mul + add, clamped to the segment's range, so a whole lane
+// group advances in one register op per sample. mul/add come from a few
+// shared envelope slots (one per articulation) computed up front in
+// setEnvelopeSlot() rather than per note. Attack approaches an overshoot
+// target so it reaches full level in its set time with an analogue-style
+// curve; decay and release fall by 60 dB over their set times, aimed just
+// past their end value so they finish exactly. Segment transitions are
+// evaluated once per controlBlockSize samples; within a control block a
+// segment is clamped at its end value.
+// A releasing voice is retired as soon as its worst-case output (envelope x
+// velocity gain x resonance peak) drops below the silence threshold, so long
+// release tails stop costing CPU once they are inaudible.
+//
+// Voice storage is sized once, to a fixed ceiling, in prepare(); the live
+// polyphony limit below it is set with setVoiceLimit() on the audio thread
+// without allocating. Re-preparing at a new sample rate with the same
+// ceiling reuses the existing storage.
+//
+// Threading: prepare() on the message thread, everything else on the audio
+// thread. getNumActiveVoices() may be called from any thread.
+class SectionVoiceBank
+{
+public:
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr int laneWidth = (int) Vec::size();
+    static constexpr int controlBlockSize = 32;
+    static constexpr int maxFilterSlots = 8;
+    static constexpr double modulationSmoothingSeconds = 0.02;
+
+    static constexpr int maxEnvelopeSlots = 8;
+
+    // Attack end value is approached from below towards this overshoot
+    static constexpr float attackTarget = 1.3f;
+
+    // Decay and release times are the time to fall by this factor (-60 dB)
+    static constexpr float segmentDecayRatio = 0.001f;
+
+    // Everything a voice needs at note-on, already resolved from
+    // SectionParams + articulation by the engine.
+    struct NoteSetup
+    {
+        int   envelopeSlot = 0; // see setEnvelopeSlot()
+        int   filterSlot = 0;   // see setFilterSlot()
+        float gain = 1.0f;      // velocity gain; section gain/pan is applied on the bus
+    };
+
+    // Voice lifecycle counts, for tracing. stopped includes stolen voices.
+    struct VoiceEventCounts
+    {
+        int started = 0;
+        int stolen = 0;
+        int stopped = 0;
+    };
+
+    SectionVoiceBank() = default;
+
+    SectionVoiceBank (const SectionVoiceBank&) = delete;
+    SectionVoiceBank& operator= (const SectionVoiceBank&) = delete;
+    SectionVoiceBank (SectionVoiceBank&&) = delete;
+    SectionVoiceBank& operator= (SectionVoiceBank&&) = delete;
+
+    // Sizes the bank for up to voiceCeiling voices (the limit starts there)
+    // and stops every voice. Storage is only reallocated when the ceiling
+    // changes.
+    void prepare (double newSampleRate, int voiceCeiling, const WavetableBank& wavetablesIn)
+    {
+        baseSampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+        sampleRate = baseSampleRate;
+        wavetables = &wavetablesIn;
+        svfTable = &SVFCoefficientTable::getInstance();
+
+        maxVoices = juce::jmax (1, voiceCeiling);
+        const auto newCapacity = ((maxVoices + laneWidth - 1) / laneWidth) * laneWidth;
+
+        if (newCapacity != capacity)
+        {
+            capacity = newCapacity;
+
+            // One block for all fields, each field array starting on a 64-byte boundary.
+            storage.allocate ((size_t) (capacity * numFields + alignmentFloats), true);
+            auto* base = storage.get();
+            base += (alignmentFloats - (int) ((reinterpret_cast<std::uintptr_t> (base) / sizeof (float)) % alignmentFloats)) % alignmentFloats;
+
+            for (int f = 0; f < numFields; ++f)
+                fields[(size_t) f] = base + (size_t) f * (size_t) capacity;
+        }
+        else
+        {
+            juce::FloatVectorOperations::clear (fields[0], capacity * numFields);
+        }
+
+        // Same size as before on a plain re-prepare, so these reuse their storage
+        voices.assign ((size_t) capacity, VoiceInfo {});
+        tableA.assign ((size_t) capacity, wavetables->getTable (0));
+        tableB.assign ((size_t) capacity, wavetables->getTable (0));
+
+        voiceLimit = maxVoices;
+        numVoices = voiceLimit;
+
+        cutoffLimit.reset (sampleRate, modulationSmoothingSeconds);
+        resonanceScale.reset (sampleRate, modulationSmoothingSeconds);
+        updateFilterSlotCoefficients();
+        updateEnvelopeSlotCoefficients();
+
+        sustainPedalDown = false;
+        noteCounter = 0;
+        activeVoiceCount.store (0, std::memory_order_relaxed);
+    }
+
+    // Base cutoff/resonance of one filter slot (the engine uses one per
+    // articulation). Call after prepare(), before rendering.
+    void setFilterSlot (int slot, float baseCutoffHz, float baseResonance)
+    {
+        auto& fs = filterSlots[(size_t) juce::jlimit (0, maxFilterSlots - 1, slot)];
+        fs.baseCutoff = baseCutoffHz;
+        fs.baseResonance = baseResonance;
+        updateFilterSlotCoefficients();
+    }
+
+    // Times and sustain level of one envelope slot (the engine uses one per
+    // articulation). Recomputes the slot's coefficients; notes already
+    // playing keep the segment they are in until their next transition.
+    void setEnvelopeSlot (int slot, float attackSeconds, float decaySeconds, float sustainLevel, float releaseSeconds)
+    {
+        auto& es = envelopeSlots[(size_t) juce::jlimit (0, maxEnvelopeSlots - 1, slot)];
+        es.attackSeconds  = juce::jmax (0.0f, attackSeconds);
+        es.decaySeconds   = juce::jmax (0.0f, decaySeconds);
+        es.sustainLevel   = juce::jlimit (0.0f, 1.0f, sustainLevel);
+        es.releaseSeconds = juce::jmax (0.0f, releaseSeconds);
+        computeEnvelopeCoefficients (es);
+    }
+
+    // Audio thread. Polyphony, clamped to the prepared ceiling. Lowering it
+    // below the number of voices sounding releases (with tail) only the
+    // excess, counting voices already releasing first, then oldest first.
+    // Voices left in slots above the new limit move down into free slots;
+    // any that don't fit keep rendering there until they finish.
+    void setVoiceLimit (int newLimit) noexcept
+    {
+        newLimit = juce::jlimit (1, juce::jmax (1, maxVoices), newLimit);
+        if (newLimit == voiceLimit)
+            return;
+
+        voiceLimit = newLimit;
+        releaseExcessVoices();
+        compactVoices();
+        updateActiveVoiceCount();
+    }
+
+    // Section-level filter modulation applied to every slot and every live
+    // voice: cutoff is capped at cutoffLimitHz and resonance is scaled.
+    // Ramps over modulationSmoothingSeconds unless immediate is set.
+    void setFilterModulation (float cutoffLimitHz, float resonanceMultiplier, bool immediate = false)
+    {
+        if (immediate)
+        {
+            cutoffLimit.setCurrentAndTargetValue (cutoffLimitHz);
+            resonanceScale.setCurrentAndTargetValue (resonanceMultiplier);
+            updateFilterSlotCoefficients();
+            applyFilterSlotsToVoices();
+            return;
+        }
+
+        cutoffLimit.setTargetValue (cutoffLimitHz);
+        resonanceScale.setTargetValue (resonanceMultiplier);
+    }
+
+    void noteOn (int midiNote, const NoteSetup& setup)
+    {
+        if (capacity == 0)
+            return;
+
+        // Re-triggering a held note releases the previous instance first.
+        for (int v = 0; v < numVoices; ++v)
+        {
+            auto& info = voices[(size_t) v];
+            if (info.stage != Stage::Idle && info.stage != Stage::Release && info.midiNote == midiNote)
+                startRelease (v);
+        }
+
+        const auto v = findVoiceForNewNote();
+
+        ++voiceEvents.started;
+        if (voices[(size_t) v].stage != Stage::Idle)
+            ++voiceEvents.stolen;
+
+        hardStop (v);
+
+        auto& info = voices[(size_t) v];
+        info.midiNote = midiNote;
+        info.keyDown = true;
+        info.sustained = false;
+        info.age = ++noteCounter;
+
+        const auto freq = juce::MidiMessage::getMidiNoteInHertz (midiNote);
+
+        tableA[(size_t) v] = wavetables->getTable (wavetables->getLevelForFrequency (freq));
+        tableB[(size_t) v] = wavetables->getTable (wavetables->getLevelForFrequency (freq * 1.01));
+        field (PhaseA)[v] = 0.0f;
+        field (PhaseB)[v] = 0.0f;
+        field (IncA)[v]   = (float) (freq / sampleRate);
+        field (IncB)[v]   = (float) (freq * 1.01 / sampleRate);
+
+        info.filterSlot = juce::jlimit (0, maxFilterSlots - 1, setup.filterSlot);
+        const auto& fs = filterSlots[(size_t) info.filterSlot];
+        field (FilterG)[v]  = fs.g;
+        field (FilterR2)[v] = fs.r2;
+        field (FilterH)[v]  = fs.h;
+
+        info.envelopeSlot = juce::jlimit (0, maxEnvelopeSlots - 1, setup.envelopeSlot);
+        enterStage (v, Stage::Attack);
+
+        field (Gain)[v] = setup.gain;
+    }
+
+    void noteOff (int midiNote, bool allowTailOff)
+    {
+        for (int v = 0; v < numVoices; ++v)
+        {
+            auto& info = voices[(size_t) v];
+            if (info.stage == Stage::Idle || ! info.keyDown || info.midiNote != midiNote)
+                continue;
+
+            info.keyDown = false;
+
+            if (! allowTailOff)
+                hardStop (v);
+            else if (sustainPedalDown)
+                info.sustained = true;
+            else
+                startRelease (v);
+        }
+    }
+
+    void setSustainPedal (bool isDown)
+    {
+        sustainPedalDown = isDown;
+
+        if (isDown)
+            return;
+
+        for (int v = 0; v < numVoices; ++v)
+        {
+            auto& info = voices[(size_t) v];
+            if (info.stage != Stage::Idle && info.sustained && ! info.keyDown)
+            {
+                info.sustained = false;
+                startRelease (v);
+            }
+        }
+    }
+
+    void allNotesOff (bool allowTailOff)
+    {
+        sustainPedalDown = false;
+
+        for (int v = 0; v < numVoices; ++v)
+        {
+            auto& info = voices[(size_t) v];
+            if (info.stage == Stage::Idle)
+                continue;
+
+            info.keyDown = false;
+            info.sustained = false;
+
+            if (allowTailOff)
+                startRelease (v);
+            else
+                hardStop (v);
+        }
+
+        updateActiveVoiceCount();
+    }
+
+    // Adds numSamples of every active voice into the mono section signal.
+    void render (float* mono, int numSamples)
+    {
+        if (capacity == 0)
+            return;
+
+        for (int offset = 0; offset < numSamples; offset += controlBlockSize)
+        {
+            const auto n = juce::jmin (controlBlockSize, numSamples - offset);
+
+            if (cutoffLimit.isSmoothing() || resonanceScale.isSmoothing())
+            {
+                cutoffLimit.skip (n);
+                resonanceScale.skip (n);
+                updateFilterSlotCoefficients();
+                applyFilterSlotsToVoices();
+            }
+
+            for (int base = 0; base < numVoices; base += laneWidth)
+                if (groupIsActive (base))
+                    renderGroup (base, mono + offset, n);
+
+            advanceEnvelopeStages();
+        }
+
+        if (numVoices > voiceLimit)
+            compactVoices(); // slots freed below the limit take voices from above it
+
+        updateActiveVoiceCount();
+    }
+
+    // Runs the voices at factor x the prepared rate, for a section rendered
+    // inside an Oversampler. Live voices (phase increments, envelope rates,
+    // filter coefficients) are rescaled in place; nothing is allocated.
+    void setOversamplingFactor (int factor) noexcept
+    {
+        const auto newRate = baseSampleRate * juce::jmax (1, factor);
+        if (newRate == sampleRate)
+            return;
+
+        const auto ratio = (float) (sampleRate / newRate);
+        sampleRate = newRate;
+
+        updateEnvelopeSlotCoefficients();
+
+        for (int v = 0; v < numVoices; ++v)
+        {
+            const auto stage = voices[(size_t) v].stage;
+            if (stage == Stage::Idle)
+                continue;
+
+            field (IncA)[v] *= ratio;
+            field (IncB)[v] *= ratio;
+            setSegmentCoefficients (v, stage);
+        }
+
+        cutoffLimit.reset (sampleRate, modulationSmoothingSeconds);
+        resonanceScale.reset (sampleRate, modulationSmoothingSeconds);
+        updateFilterSlotCoefficients();
+        applyFilterSlotsToVoices();
+    }
+
+    // Linear amplitude below which a releasing voice is retired; 0 disables early retirement.
+    void setSilenceThreshold (float linearGain) noexcept
+    {
+        silenceThreshold = juce::jmax (0.0f, linearGain);
+    }
+
+    // Audio thread: true when no voice is sounding, i.e. render() would add nothing.
+    bool isSilent() const noexcept
+    {
+        return activeVoiceCount.load (std::memory_order_relaxed) == 0;
+    }
+
+    int getNumActiveVoices() const noexcept
+    {
+        return activeVoiceCount.load (std::memory_order_relaxed);
+    }
+
+    // Audio thread: voice events since the previous call.
+    VoiceEventCounts takeVoiceEventCounts() noexcept
+    {
+        return std::exchange (voiceEvents, VoiceEventCounts {});
+    }
+
+    int getVoiceLimit() const noexcept { return voiceLimit; }
+    int getVoiceCeiling() const noexcept { return maxVoices; }
+
+private:
+    enum Field
+    {
+        PhaseA, PhaseB, IncA, IncB,
+        FilterS1, FilterS2, FilterG, FilterR2, FilterH,
+        EnvLevel, EnvMul, EnvAdd, EnvLow, EnvHigh,
+        Gain,
+        numFields
+    };
+
+    enum class Stage : std::uint8_t { Idle, Attack, Decay, Sustain, Release };
+
+    struct VoiceInfo
+    {
+        Stage stage = Stage::Idle;
+        int midiNote = -1;
+        bool keyDown = false;
+        bool sustained = false;
+        std::uint32_t age = 0;
+        int filterSlot = 0;
+        int envelopeSlot = 0;
+    };
+
+    struct FilterSlot
+    {
+        float baseCutoff = 12000.0f;
+        float baseResonance = 0.7f;
+
+        // Current TPT SVF coefficients after section modulation
+        float g = 0.0f, r2 = 1.0f, h = 1.0f;
+    };
+
+    struct EnvelopeSlot
+    {
+        float attackSeconds  = 0.01f;
+        float decaySeconds   = 0.05f;
+        float sustainLevel   = 0.8f;
+        float releaseSeconds = 0.2f;
+
+        // level = level * mul + add per segment, at the current sample rate
+        float attackMul = 0.0f,  attackAdd = 1.0f;
+        float decayMul = 0.0f,   decayAdd = 0.8f;
+        float releaseMul = 0.0f, releaseAdd = 0.0f;
+    };
+
+    static constexpr int alignmentFloats = 64 / (int) sizeof (float);
+
+    float* field (Field f) noexcept { return fields[(size_t) f]; }
+
+    bool groupIsActive (int base) const noexcept
+    {
+        for (int l = 0; l < laneWidth; ++l)
+            if (voices[(size_t) (base + l)].stage != Stage::Idle)
+                return true;
+        return false;
+    }
+
+    void updateFilterSlotCoefficients() noexcept
+    {
+        if (svfTable == nullptr)
+            return; // not prepared yet
+
+        const auto limit = cutoffLimit.getCurrentValue();
+        const auto scale = resonanceScale.getCurrentValue();
+
+        for (auto& fs : filterSlots)
+        {
+            const auto cutoff = juce::jmax (20.0f, juce::jmin (fs.baseCutoff, limit));
+            const auto c = svfTable->get (cutoff, fs.baseResonance * scale, sampleRate);
+
+            fs.g  = c.g;
+            fs.r2 = c.r2;
+            fs.h  = c.h;
+        }
+    }
+
+    // Exponential approach to target that leaves remainingFraction of the
+    // initial distance after seconds: {mul, add} for level = level * mul + add.
+    std::pair<float, float> approach (float target, float seconds, float remainingFraction) const noexcept
+    {
+        const auto samples = juce::jmax (1.0, (double) seconds * sampleRate);
+        const auto mul = (float) std::pow ((double) remainingFraction, 1.0 / samples);
+        return { mul, (1.0f - mul) * target };
+    }
+
+    void computeEnvelopeCoefficients (EnvelopeSlot& es) const noexcept
+    {
+        // Attack: from 0 towards attackTarget, crossing 1 after attackSeconds
+        std::tie (es.attackMul, es.attackAdd) = approach (attackTarget, es.attackSeconds, 1.0f - 1.0f / attackTarget);
+
+        // Decay/release: aimed just below their end value, which they hit after
+        // falling by segmentDecayRatio (from full scale) over their time.
+        const auto overshoot = segmentDecayRatio / (1.0f - segmentDecayRatio);
+        const auto decayTarget = es.sustainLevel - (1.0f - es.sustainLevel) * overshoot;
+
+        std::tie (es.decayMul, es.decayAdd)     = approach (decayTarget, es.decaySeconds, segmentDecayRatio);
+        std::tie (es.releaseMul, es.releaseAdd) = approach (-overshoot, es.releaseSeconds, segmentDecayRatio);
+    }
+
+    void updateEnvelopeSlotCoefficients() noexcept
+    {
+        for (auto& es : envelopeSlots)
+            computeEnvelopeCoefficients (es);
+    }
+
+    void setSegmentCoefficients (int v, Stage stage) noexcept
+    {
+        const auto& es = envelopeSlots[(size_t) voices[(size_t) v].envelopeSlot];
+
+        switch (stage)
+        {
+            case Stage::Attack:  field (EnvMul)[v] = es.attackMul;  field (EnvAdd)[v] = es.attackAdd;  break;
+            case Stage::Decay:   field (EnvMul)[v] = es.decayMul;   field (EnvAdd)[v] = es.decayAdd;   break;
+            case Stage::Release: field (EnvMul)[v] = es.releaseMul; field (EnvAdd)[v] = es.releaseAdd; break;
+
+            case Stage::Sustain:
+            case Stage::Idle:
+            default:
+                field (EnvMul)[v] = 1.0f;
+                field (EnvAdd)[v] = 0.0f;
+                break;
+        }
+    }
+
+    // Switches voice v to stage with that segment's coefficients and clamp range.
+    void enterStage (int v, Stage stage) noexcept
+    {
+        auto& info = voices[(size_t) v];
+        const auto& es = envelopeSlots[(size_t) info.envelopeSlot];
+        info.stage = stage;
+        setSegmentCoefficients (v, stage);
+
+        switch (stage)
+        {
+            case Stage::Attack:  field (EnvLow)[v] = 0.0f;            field (EnvHigh)[v] = 1.0f; break;
+            case Stage::Decay:   field (EnvLow)[v] = es.sustainLevel; field (EnvHigh)[v] = 1.0f; break;
+            case Stage::Sustain: field (EnvLow)[v] = es.sustainLevel; field (EnvHigh)[v] = es.sustainLevel; break;
+            case Stage::Release: field (EnvLow)[v] = 0.0f;            field (EnvHigh)[v] = 1.0f; break;
+
+            case Stage::Idle:
+            default:
+                break;
+        }
+    }
+
+    void applyFilterSlotsToVoices() noexcept
+    {
+        for (int v = 0; v < numVoices; ++v)
+        {
+            const auto& info = voices[(size_t) v];
+            if (info.stage == Stage::Idle)
+                continue;
+
+            const auto& fs = filterSlots[(size_t) info.filterSlot];
+            field (FilterG)[v]  = fs.g;
+            field (FilterR2)[v] = fs.r2;
+            field (FilterH)[v]  = fs.h;
+        }
+    }
+
+    void renderGroup (int base, float* mono, int numSamples) noexcept
+    {
+        auto load = [this, base] (Field f) { return Vec::fromRawArray (field (f) + base); };
+
+        auto s1 = load (FilterS1);
+        auto s2 = load (FilterS2);
+        const auto g   = load (FilterG);
+        const auto h   = load (FilterH);
+        const auto gR2 = g + load (FilterR2);
+
+        auto level = load (EnvLevel);
+        const auto mul   = load (EnvMul);
+        const auto add   = load (EnvAdd);
+        const auto lo    = load (EnvLow);
+        const auto hi    = load (EnvHigh);
+
+        const auto gain = load (Gain);
+
+        auto* phaseA = field (PhaseA) + base;
+        auto* phaseB = field (PhaseB) + base;
+        const auto* incA = field (IncA) + base;
+        const auto* incB = field (IncB) + base;
+        const auto* const* tabA = tableA.data() + base;
+        const auto* const* tabB = tableB.data() + base;
+
+        alignas (64) float osc[(size_t) laneWidth];
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            for (int l = 0; l < laneWidth; ++l)
+            {
+                osc[l] = 0.5f * (WavetableBank::read (tabA[l], phaseA[l])
+                                 + WavetableBank::read (tabB[l], phaseB[l]));
+
+                phaseA[l] += incA[l];
+                phaseA[l] -= (float) (int) phaseA[l];
+                phaseB[l] += incB[l];
+                phaseB[l] -= (float) (int) phaseB[l];
+            }
+
+            const auto x  = Vec::fromRawArray (osc);
+            const auto hp = (x - s1 * gR2 - s2) * h;
+            const auto bp = hp * g + s1;
+            s1 = hp * g + bp;
+            const auto lp = bp * g + s2;
+            s2 = bp * g + lp;
+
+            level = Vec::min (Vec::max (level * mul + add, lo), hi);
+
+            mono[n] += (lp * level * gain).sum();
+        }
+
+        s1.copyToRawArray (field (FilterS1) + base);
+        s2.copyToRawArray (field (FilterS2) + base);
+        level.copyToRawArray (field (EnvLevel) + base);
+    }
+
+    void advanceEnvelopeStages() noexcept
+    {
+        for (int v = 0; v < numVoices; ++v)
+        {
+            auto& info = voices[(size_t) v];
+            const auto level = field (EnvLevel)[v];
+
+            switch (info.stage)
+            {
+                case Stage::Attack:
+                    if (level >= 1.0f)
+                        enterStage (v, Stage::Decay);
+                    break;
+
+                case Stage::Decay:
+                    if (level <= envelopeSlots[(size_t) info.envelopeSlot].sustainLevel)
+                        enterStage (v, Stage::Sustain);
+                    break;
+
+                case Stage::Release:
+                    if (level <= 0.0f || isInaudible (v, level))
+                        hardStop (v);
+                    break;
+
+                case Stage::Idle:
+                case Stage::Sustain:
+                default:
+                    break;
+            }
+        }
+    }
+
+    // A free slot below the limit while fewer than voiceLimit voices sound;
+    // otherwise a voice to steal: the oldest held one if voiceLimit are held,
+    // else the oldest releasing one. A victim above the limit is stopped here
+    // and a free slot below it used instead, so voices drift back under it.
+    int findVoiceForNewNote() noexcept
+    {
+        int numActive = 0, numHeld = 0, firstFree = -1;
+        int oldestHeld = -1, oldestReleasing = -1;
+
+        for (int v = 0; v < numVoices; ++v)
+        {
+            const auto& info = voices[(size_t) v];
+
+            if (info.stage == Stage::Idle)
+            {
+                if (firstFree < 0 && v < voiceLimit)
+                    firstFree = v;
+                continue;
+            }
+
+            ++numActive;
+
+            if (info.stage == Stage::Release)
+            {
+                if (oldestReleasing < 0 || info.age < voices[(size_t) oldestReleasing].age)
+                    oldestReleasing = v;
+            }
+            else
+            {
+                ++numHeld;
+                if (oldestHeld < 0 || info.age < voices[(size_t) oldestHeld].age)
+                    oldestHeld = v;
+            }
+        }
+
+        if (firstFree >= 0 && numActive < voiceLimit)
+            return firstFree;
+
+        const auto victim = (numHeld >= voiceLimit || oldestReleasing < 0) ? oldestHeld : oldestReleasing;
+
+        if (victim >= voiceLimit && firstFree >= 0)
+        {
+            ++voiceEvents.stolen;
+            hardStop (victim);
+            return firstFree;
+        }
+
+        return victim;
+    }
+
+    // After the limit drops: releases the oldest held voices until no more
+    // than voiceLimit voices are held or sustaining.
+    void releaseExcessVoices() noexcept
+    {
+        int numActive = 0, numReleasing = 0;
+        for (int v = 0; v < numVoices; ++v)
+        {
+            const auto stage = voices[(size_t) v].stage;
+            numActive += stage != Stage::Idle ? 1 : 0;
+            numReleasing += stage == Stage::Release ? 1 : 0;
+        }
+
+        for (auto excess = numActive - numReleasing - voiceLimit; excess > 0; --excess)
+        {
+            int oldest = -1;
+            for (int v = 0; v < numVoices; ++v)
+            {
+                const auto& info = voices[(size_t) v];
+                if (info.stage != Stage::Idle && info.stage != Stage::Release
+                    && (oldest < 0 || info.age < voices[(size_t) oldest].age))
+                    oldest = v;
+            }
+
+            auto& info = voices[(size_t) oldest];
+            info.keyDown = false;
+            info.sustained = false;
+            startRelease (oldest);
+        }
+    }
+
+    // Moves voices sounding above the limit into free slots below it.
+    void compactVoices() noexcept
+    {
+        int to = 0;
+
+        for (int from = voiceLimit; from < numVoices; ++from)
+        {
+            if (voices[(size_t) from].stage == Stage::Idle)
+                continue;
+
+            while (to < voiceLimit && voices[(size_t) to].stage != Stage::Idle)
+                ++to;
+
+            if (to == voiceLimit)
+                return;
+
+            moveVoice (from, to);
+        }
+    }
+
+    // All per-voice state lives in the field arrays, tables and info, so a
+    // voice can change slot (and SIMD lane) between blocks without a click.
+    void moveVoice (int from, int to) noexcept
+    {
+        for (int f = 0; f < numFields; ++f)
+        {
+            field ((Field) f)[to] = field ((Field) f)[from];
+            field ((Field) f)[from] = 0.0f;
+        }
+
+        tableA[(size_t) to] = tableA[(size_t) from];
+        tableB[(size_t) to] = tableB[(size_t) from];
+        voices[(size_t) to] = voices[(size_t) from];
+        voices[(size_t) from] = {};
+    }
+
+    bool isInaudible (int v, float level) noexcept
+    {
+        // 1 / r2 is the SVF's resonant peak gain (Q), bounded below by unity.
+        const auto peak = level * field (Gain)[v] * juce::jmax (1.0f, 1.0f / field (FilterR2)[v]);
+        return peak < silenceThreshold;
+    }
+
+    void startRelease (int v) noexcept
+    {
+        enterStage (v, Stage::Release);
+    }
+
+    void hardStop (int v) noexcept
+    {
+        auto& info = voices[(size_t) v];
+        if (info.stage != Stage::Idle)
+            ++voiceEvents.stopped;
+
+        info.stage = Stage::Idle;
+        info.keyDown = false;
+        info.sustained = false;
+
+        for (auto f : { FilterS1, FilterS2, EnvLevel, EnvMul, EnvAdd, EnvLow, EnvHigh, Gain })
+            field (f)[v] = 0.0f;
+    }
+
+    // Also shrinks numVoices back to the limit once voices left above it
+    // (after a lower setVoiceLimit()) have finished.
+    void updateActiveVoiceCount() noexcept
+    {
+        int count = 0, end = voiceLimit;
+        for (int v = 0; v < numVoices; ++v)
+        {
+            if (voices[(size_t) v].stage != Stage::Idle)
+            {
+                ++count;
+                end = juce::jmax (end, v + 1);
+            }
+        }
+
+        numVoices = end;
+        activeVoiceCount.store (count, std::memory_order_relaxed);
+    }
+
+    double baseSampleRate = 44100.0;
+    double sampleRate = 44100.0; // baseSampleRate * oversampling factor
+    const WavetableBank* wavetables = nullptr;
+    const SVFCoefficientTable* svfTable = nullptr;
+
+    int maxVoices = 0;  // ceiling from prepare()
+    int voiceLimit = 0; // voices new notes may use, <= maxVoices
+    int numVoices = 0;  // voices loops scan: the limit, or past it while voices left above it finish
+    int capacity = 0;   // maxVoices rounded up to whole lane groups
+
+    juce::HeapBlock<float> storage;
+    std::array<float*, (size_t) numFields> fields {};
+
+    std::vector<VoiceInfo> voices;
+    std::vector<const float*> tableA;
+    std::vector<const float*> tableB;
+
+    std::array<FilterSlot, (size_t) maxFilterSlots> filterSlots {};
+    std::array<EnvelopeSlot, (size_t) maxEnvelopeSlots> envelopeSlots {};
+    juce::SmoothedValue<float> cutoffLimit { 20000.0f };
+    juce::SmoothedValue<float> resonanceScale { 1.0f };
+
+    bool sustainPedalDown = false;
+    std::uint32_t noteCounter = 0;
+    float silenceThreshold = 0.0f;
+    VoiceEventCounts voiceEvents;
+    std::atomic<int> activeVoiceCount { 0 };
+};
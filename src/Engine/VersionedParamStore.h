@@ -0,0 +1,109 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Seqlock-protected slot for a small trivially-copyable parameter struct.
+//
+// Writers (message thread, preset loading, host state restore) publish a
+// whole struct; readers on any thread get a consistent copy without taking a
+// lock. The payload is stored as relaxed atomic words, so concurrent
+// reads/writes are well-defined, and the sequence counter doubles as a
+// version number: the audio thread compares getVersion() against the last
+// version it applied and only copies when something actually changed.
+//
+// Readers only retry while a store is in flight (a few word stores), and
+// never block a writer. Writers serialise among themselves with a CAS on the
+// sequence, which is fine because they never run on the audio thread.
+template <typename T>
+class VersionedParamStore
+{
+public:
+    static_assert (std::is_trivially_copyable_v<T>, "VersionedParamStore needs a trivially copyable type");
+
+    VersionedParamStore() { store (T {}); }
+
+    explicit VersionedParamStore (const T& initial) { store (initial); }
+
+    VersionedParamStore (const VersionedParamStore&) = delete;
+    VersionedParamStore& operator= (const VersionedParamStore&) = delete;
+    VersionedParamStore (VersionedParamStore&&) = delete;
+    VersionedParamStore& operator= (VersionedParamStore&&) = delete;
+
+    void store (const T& value) noexcept
+    {
+        Words words {};
+        std::memcpy (words.data(), static_cast<const void*> (&value), sizeof (T));
+
+        // Take the write side: even -> odd.
+        auto seq = sequence.load (std::memory_order_relaxed);
+        for (;;)
+        {
+            if ((seq & 1u) == 0
+                && sequence.compare_exchange_weak (seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                break;
+
+            std::this_thread::yield();
+            seq = sequence.load (std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence (std::memory_order_release);
+
+        for (size_t i = 0; i < numWords; ++i)
+            data[i].store (words[i], std::memory_order_relaxed);
+
+        sequence.store (seq + 2, std::memory_order_release);
+    }
+
+    // Copies a consistent value into dest and returns its version.
+    std::uint32_t load (T& dest) const noexcept
+    {
+        Words words {};
+
+        for (;;)
+        {
+            const auto before = sequence.load (std::memory_order_acquire);
+
+            if ((before & 1u) == 0)
+            {
+                for (size_t i = 0; i < numWords; ++i)
+                    words[i] = data[i].load (std::memory_order_relaxed);
+
+                std::atomic_thread_fence (std::memory_order_acquire);
+
+                if (sequence.load (std::memory_order_relaxed) == before)
+                {
+                    std::memcpy (static_cast<void*> (&dest), words.data(), sizeof (T));
+                    return before >> 1;
+                }
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    T load() const noexcept
+    {
+        T value;
+        load (value);
+        return value;
+    }
+
+    // Monotonic change counter; cheap enough to poll every block.
+    std::uint32_t getVersion() const noexcept
+    {
+        return sequence.load (std::memory_order_acquire) >> 1;
+    }
+
+private:
+    static constexpr size_t numWords = (sizeof (T) + sizeof (std::uint32_t) - 1) / sizeof (std::uint32_t);
+    using Words = std::array<std::uint32_t, numWords>;
+
+    std::atomic<std::uint32_t> sequence { 0 };
+    std::array<std::atomic<std::uint32_t>, numWords> data {};
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Bounded multi-producer / single-consumer queue for MIDI generated off the
+// audio thread (on-screen keyboard, mixer pads, scripting).
+//
+// Each cell carries its own sequence number (Vyukov-style ring): producers
+// claim a slot with one CAS on the write index and publish it with a release
+// store, so they never wait on each other or on the audio thread, and a
+// producer preempted mid-push only delays its own cell. The consumer pops
+// without any read-modify-write. A full queue rejects the push rather than
+// blocking.
+//
+// Every event is stamped with juce::Time::getMillisecondCounterHiRes() when
+// it is posted, so the audio thread can place it at the matching offset in
+// the next block instead of bunching everything at sample 0.
+class VirtualMidiQueue
+{
+public:
+    struct Event
+    {
+        double timestampMs = 0.0;
+        std::uint8_t data[3] {};
+        std::uint8_t size = 0;
+    };
+
+    explicit VirtualMidiQueue (int capacityPowerOfTwo = 1024)
+    {
+        const auto capacity = (std::uint32_t) juce::nextPowerOfTwo (juce::jmax (2, capacityPowerOfTwo));
+        mask = capacity - 1;
+        cells = std::make_unique<Cell[]> (capacity);
+
+        for (std::uint32_t i = 0; i < capacity; ++i)
+            cells[i].sequence.store (i, std::memory_order_relaxed);
+    }
+
+    VirtualMidiQueue (const VirtualMidiQueue&) = delete;
+    VirtualMidiQueue& operator= (const VirtualMidiQueue&) = delete;
+    VirtualMidiQueue (VirtualMidiQueue&&) = delete;
+    VirtualMidiQueue& operator= (VirtualMidiQueue&&) = delete;
+
+    // Any thread. Returns false (and counts the event) when the queue is full.
+    bool push (const std::uint8_t* data, int size, double timestampMs) noexcept
+    {
+        auto pos = writeIndex.load (std::memory_order_relaxed);
+
+        for (;;)
+        {
+            auto& cell = cells[pos & mask];
+            const auto seq = cell.sequence.load (std::memory_order_acquire);
+            const auto diff = (std::int32_t) (seq - pos);
+
+            if (diff == 0)
+            {
+                if (writeIndex.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.event.timestampMs = timestampMs;
+                    cell.event.size = (std::uint8_t) juce::jlimit (0, 3, size);
+                    for (int i = 0; i < cell.event.size; ++i)
+                        cell.event.data[i] = data[i];
+
+                    cell.sequence.store (pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                droppedCount.fetch_add (1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                pos = writeIndex.load (std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Audio thread only. False when empty, or when the next producer has
+    // claimed its slot but not finished writing it yet (picked up next block).
+    bool pop (Event& dest) noexcept
+    {
+        auto& cell = cells[readIndex & mask];
+        const auto seq = cell.sequence.load (std::memory_order_acquire);
+
+        if ((std::int32_t) (seq - (readIndex + 1)) < 0)
+            return false;
+
+        dest = cell.event;
+        cell.sequence.store (readIndex + mask + 1, std::memory_order_release);
+        ++readIndex;
+        return true;
+    }
+
+    int getCapacity() const noexcept { return (int) mask + 1; }
+
+    std::uint64_t getDroppedCount() const noexcept
+    {
+        return droppedCount.load (std::memory_order_relaxed);
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::uint32_t> sequence { 0 };
+        Event event;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::uint32_t mask = 0;
+
+    alignas (64) std::atomic<std::uint32_t> writeIndex { 0 };
+    alignas (64) std::uint32_t readIndex = 0;
+    std::atomic<std::uint64_t> droppedCount { 0 };
+};
@@ -10,6 +10,11 @@ OrchestraSynthAudioProcessor::OrchestraSynthAudioProcessor()
 {
 }
 
+OrchestraSynthAudioProcessor::~OrchestraSynthAudioProcessor()
+{
+    cancelPendingUpdate();
+}
+
 const juce::String OrchestraSynthAudioProcessor::getName() const
 {
     return "OrchestraSynth";
@@ -18,6 +23,10 @@ const juce::String OrchestraSynthAudioProcessor::getName() const
 void OrchestraSynthAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     engine.prepare (sampleRate, samplesPerBlock);
+
+    const auto latency = engine.getLatencySamples();
+    reportedLatencySamples.store (latency, std::memory_order_relaxed);
+    setLatencySamples (latency);
 }
 
 void OrchestraSynthAudioProcessor::releaseResources()
@@ -25,6 +34,12 @@ void OrchestraSynthAudioProcessor::releaseResources()
     engine.reset();
 }
 
+void OrchestraSynthAudioProcessor::setNonRealtime (bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime (isNonRealtime);
+    engine.setNonRealtime (isNonRealtime);
+}
+
 bool OrchestraSynthAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
     if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
@@ -43,6 +58,19 @@ void OrchestraSynthAudioProcessor::processBlock (juce::AudioBuffer<float>& buffe
                       buffer.getNumSamples());
 
     engine.processBlock (buffer, midi);
+
+    // A section's oversampling factor changed: tell the host about the new
+    // delay from the message thread (setLatencySamples notifies the host and
+    // listeners synchronously).
+    if (engine.getLatencySamples() != reportedLatencySamples.load (std::memory_order_relaxed))
+        triggerAsyncUpdate();
+}
+
+void OrchestraSynthAudioProcessor::handleAsyncUpdate()
+{
+    const auto latency = engine.getLatencySamples();
+    reportedLatencySamples.store (latency, std::memory_order_relaxed);
+    setLatencySamples (latency);
 }
 
 juce::AudioProcessorEditor* OrchestraSynthAudioProcessor::createEditor()
@@ -8,11 +8,12 @@
 
 class MixerComponent;
 
-class OrchestraSynthAudioProcessor  : public juce::AudioProcessor
+class OrchestraSynthAudioProcessor  : public juce::AudioProcessor,
+                                      private juce::AsyncUpdater
 {
 public:
     OrchestraSynthAudioProcessor();
-    ~OrchestraSynthAudioProcessor() override = default;
+    ~OrchestraSynthAudioProcessor() override;
 
     // AudioProcessor overrides
     const juce::String getName() const override;
@@ -20,6 +21,7 @@ public:
     void releaseResources() override;
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void setNonRealtime (bool isNonRealtime) noexcept override;
 
     bool hasEditor() const override                                        { return true; }
     juce::AudioProcessorEditor* createEditor() override;
@@ -43,10 +45,15 @@ public:
     [[nodiscard]] std::unique_ptr<MixerComponent> createMixerComponent();
 
 private:
+    // Reports the engine's latency to the host; message thread
+    void handleAsyncUpdate() override;
+
     Logger logger;
     PerformanceMonitor perfMon { logger };
     PresetManager presetManager;
     OrchestraSynthEngine engine { presetManager, perfMon, logger };
 
+    std::atomic<int> reportedLatencySamples { 0 }; // last value passed to setLatencySamples()
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OrchestraSynthAudioProcessor)
 };
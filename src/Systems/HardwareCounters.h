@@ -0,0 +1,202 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#if JUCE_LINUX
+ #include <linux/perf_event.h>
+ #include <sys/ioctl.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+// CPU performance counters for the calling thread, via Linux perf_event_open.
+//
+// open() creates one counter group (cycles leading; instructions, L1D read
+// misses, last-level cache misses, branch misses following) measuring the
+// thread that calls it, user space only. Counters the CPU or kernel refuses
+// are left out; if the cycles leader itself cannot be opened (no PMU in a VM,
+// kernel.perf_event_paranoid too strict, not Linux) open() fails and
+// getLastError() / describeError() say why. read() is a single read() syscall for the whole
+// group and scales for multiplexing.
+//
+// Not thread-safe: open/read/close from the measured thread.
+class HardwareCounters
+{
+public:
+    enum Counter { Cycles = 0, Instructions, L1DReadMisses, LLCMisses, BranchMisses, numCounters };
+
+    using Values = std::array<std::uint64_t, (size_t) numCounters>;
+
+    HardwareCounters() { slots.fill (-1); }
+
+    ~HardwareCounters()
+    {
+        close();
+    }
+
+    HardwareCounters (const HardwareCounters&) = delete;
+    HardwareCounters& operator= (const HardwareCounters&) = delete;
+    HardwareCounters (HardwareCounters&&) = delete;
+    HardwareCounters& operator= (HardwareCounters&&) = delete;
+
+    static const char* getCounterName (Counter c) noexcept
+    {
+        switch (c)
+        {
+            case Cycles:        return "cycles";
+            case Instructions:  return "instructions";
+            case L1DReadMisses: return "l1dMisses";
+            case LLCMisses:     return "llcMisses";
+            case BranchMisses:  return "branchMisses";
+            case numCounters:
+            default:            return "";
+        }
+    }
+
+    bool open()
+    {
+        close();
+
+       #if JUCE_LINUX
+        const std::uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D
+                                        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+        const std::pair<std::uint32_t, std::uint64_t> events[numCounters]
+        {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HW_CACHE, l1dReadMiss },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+
+        for (int c = 0; c < numCounters; ++c)
+        {
+            perf_event_attr attr;
+            std::memset (&attr, 0, sizeof (attr));
+            attr.size = sizeof (attr);
+            attr.type = events[c].first;
+            attr.config = events[c].second;
+            attr.disabled = c == Cycles ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            const auto fd = (int) syscall (SYS_perf_event_open, &attr, 0, -1, c == Cycles ? -1 : leaderFd, 0);
+
+            if (fd < 0)
+            {
+                if (c == Cycles)
+                {
+                    lastError = errno;
+                    return false;
+                }
+
+                continue; // optional counter not supported here
+            }
+
+            if (c == Cycles)
+                leaderFd = fd;
+            else
+                memberFds[(size_t) c] = fd;
+
+            slots[(size_t) c] = numOpen++;
+        }
+
+        ioctl (leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl (leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        lastError = 0;
+        return true;
+       #else
+        lastError = ENOSYS;
+        return false;
+       #endif
+    }
+
+    void close()
+    {
+       #if JUCE_LINUX
+        for (auto& fd : memberFds)
+        {
+            if (fd >= 0)
+                ::close (fd);
+            fd = -1;
+        }
+
+        if (leaderFd >= 0)
+            ::close (leaderFd);
+       #endif
+
+        leaderFd = -1;
+        numOpen = 0;
+        slots.fill (-1);
+    }
+
+    bool isOpen() const noexcept { return leaderFd >= 0; }
+
+    // True if counter c was opened (cycles always is, when isOpen()).
+    bool has (Counter c) const noexcept { return slots[(size_t) c] >= 0; }
+
+    // errno from the last failed open(), 0 after a successful one.
+    int getLastError() const noexcept { return lastError; }
+
+    // Human-readable reason for an open() errno.
+    static juce::String describeError (int error)
+    {
+        switch (error)
+        {
+            case 0:      return "ok";
+            case EACCES:
+            case EPERM:  return "not permitted (see /proc/sys/kernel/perf_event_paranoid)";
+            case ENOENT:
+            case ENODEV:
+            case EOPNOTSUPP: return "no hardware counters available";
+            case ENOSYS: return "not supported on this platform";
+            default:     return "perf_event_open failed, errno " + juce::String (error);
+        }
+    }
+
+    // Running totals since open(), scaled up if the kernel multiplexed the group.
+    bool read (Values& values) const noexcept
+    {
+        values.fill (0);
+
+       #if JUCE_LINUX
+        if (leaderFd < 0)
+            return false;
+
+        // nr, time_enabled, time_running, value[nr]
+        std::uint64_t buffer[3 + numCounters] {};
+        if (::read (leaderFd, buffer, sizeof (buffer)) < (ssize_t) (3 * sizeof (std::uint64_t)))
+            return false;
+
+        const auto enabled = buffer[1];
+        const auto running = buffer[2];
+        const auto scale = running > 0 && running < enabled ? (double) enabled / (double) running : 1.0;
+
+        for (int c = 0; c < numCounters; ++c)
+        {
+            const auto slot = slots[(size_t) c];
+            if (slot >= 0 && (std::uint64_t) slot < buffer[0])
+                values[(size_t) c] = (std::uint64_t) ((double) buffer[3 + slot] * scale);
+        }
+
+        return true;
+       #else
+        return false;
+       #endif
+    }
+
+private:
+    int leaderFd = -1;
+    std::array<int, (size_t) numCounters> memberFds { -1, -1, -1, -1, -1 };
+    std::array<int, (size_t) numCounters> slots {}; // position in the group read, -1 if not open
+    int numOpen = 0;
+    int lastError = 0;
+};
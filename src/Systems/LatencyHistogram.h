@@ -0,0 +1,131 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+// Log-bucketed histogram of non-negative integer values, HdrHistogram-style.
+//
+// Values below subBucketCount get a bucket each; above that, every power of
+// two is split into subBucketCount / 2 linear sub-buckets, so any recorded
+// value is known to within 1 / 32 (~3 %) of itself from 0 up to maxValue.
+// Larger values are clamped into the top bucket.
+//
+// record() is one relaxed atomic increment, wait-free, for a single writer
+// (the audio thread). Readers copy the counts with getCounts() from any
+// thread; a copy taken while recording is going on can be a few counts out
+// of date but is never torn per bucket. Windows are done by subtracting an
+// earlier copy rather than clearing, so the writer never waits on a reader.
+class LatencyHistogram
+{
+public:
+    static constexpr int subBucketBits = 6;
+    static constexpr int subBucketCount = 1 << subBucketBits;
+    static constexpr int subBucketHalf = subBucketCount / 2;
+    static constexpr int maxValueBits = 31;
+    static constexpr std::uint64_t maxValue = (std::uint64_t (1) << maxValueBits) - 1;
+    static constexpr int numBuckets = subBucketCount + (maxValueBits - subBucketBits) * subBucketHalf;
+
+    using Counts = std::array<std::uint64_t, (size_t) numBuckets>;
+
+    struct Summary
+    {
+        std::uint64_t count = 0;
+        std::uint64_t p50 = 0;
+        std::uint64_t p99 = 0;
+        std::uint64_t p999 = 0;
+        std::uint64_t max = 0; // upper edge of the highest non-empty bucket
+    };
+
+    LatencyHistogram() = default;
+
+    LatencyHistogram (const LatencyHistogram&) = delete;
+    LatencyHistogram& operator= (const LatencyHistogram&) = delete;
+    LatencyHistogram (LatencyHistogram&&) = delete;
+    LatencyHistogram& operator= (LatencyHistogram&&) = delete;
+
+    void record (std::uint64_t value) noexcept
+    {
+        counts[(size_t) getBucketIndex (value)].fetch_add (1, std::memory_order_relaxed);
+    }
+
+    void getCounts (Counts& dest) const noexcept
+    {
+        for (size_t i = 0; i < dest.size(); ++i)
+            dest[i] = counts[i].load (std::memory_order_relaxed);
+    }
+
+    static int getBucketIndex (std::uint64_t value) noexcept
+    {
+        value = juce::jmin (value, maxValue);
+
+        if (value < (std::uint64_t) subBucketCount)
+            return (int) value;
+
+        // Shift that leaves value in [subBucketHalf, subBucketCount)
+        const auto shift = (int) std::bit_width (value) - subBucketBits;
+        return subBucketCount + (shift - 1) * subBucketHalf + (int) (value >> shift) - subBucketHalf;
+    }
+
+    // Largest value that falls into bucket index.
+    static std::uint64_t getBucketUpperValue (int index) noexcept
+    {
+        if (index < subBucketCount)
+            return (std::uint64_t) index;
+
+        const auto shift = (index - subBucketCount) / subBucketHalf + 1;
+        const auto sub = (std::uint64_t) ((index - subBucketCount) % subBucketHalf + subBucketHalf);
+        return ((sub + 1) << shift) - 1;
+    }
+
+    // Percentiles of counts - baseline (pass nullptr for everything recorded).
+    static Summary summarise (const Counts& counts, const Counts* baseline = nullptr) noexcept
+    {
+        auto countAt = [&] (size_t i)
+        {
+            const auto c = counts[i];
+            const auto b = baseline != nullptr ? (*baseline)[i] : 0;
+            return c > b ? c - b : 0;
+        };
+
+        Summary s;
+        for (size_t i = 0; i < counts.size(); ++i)
+            s.count += countAt (i);
+
+        if (s.count == 0)
+            return s;
+
+        // Smallest value with at least fraction of the samples at or below it
+        auto rankOf = [&s] (double fraction)
+        {
+            return juce::jmax ((std::uint64_t) 1, (std::uint64_t) std::ceil (fraction * (double) s.count));
+        };
+
+        const std::uint64_t ranks[] { rankOf (0.5), rankOf (0.99), rankOf (0.999) };
+        std::uint64_t* results[] { &s.p50, &s.p99, &s.p999 };
+
+        std::uint64_t cumulative = 0;
+        size_t next = 0;
+
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            const auto c = countAt (i);
+            if (c == 0)
+                continue;
+
+            cumulative += c;
+            s.max = getBucketUpperValue ((int) i);
+
+            while (next < 3 && cumulative >= ranks[next])
+                *results[next++] = s.max;
+        }
+
+        return s;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, (size_t) numBuckets> counts {};
+};
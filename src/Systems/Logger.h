@@ -1,10 +1,33 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+// Application log, safe to call from any thread including the audio thread.
+//
+// Records go into a fixed-capacity lock-free MPSC ring (Vyukov-style, one
+// sequence number per slot), so log() never locks or allocates. A full ring
+// drops the record and counts it. A background thread drains the ring every
+// drainIntervalMs, formats the records and hands them to:
+//   - a bounded in-memory tail (the newest maxTailEntries), for the UI
+//   - juce::Logger::outputDebugString
+//   - an optional rotating file sink (setFileSink())
+//
+// Real-time callers use logDeferred() with a string-literal format and up to
+// maxArgs numeric / string-literal arguments, substituted for "{}" on the
+// drain thread. log (level, juce::String) is for everything else: the caller
+// builds the String (which allocates), the copy into the ring does not;
+// messages longer than maxTextBytes are truncated.
 class Logger
 {
 public:
@@ -17,26 +40,96 @@ public:
         juce::String message;
     };
 
-    Logger() = default;
+    static constexpr int ringCapacity = 1024; // power of two
+    static constexpr int maxTextBytes = 192;
+    static constexpr int maxArgs = 4;
+    static constexpr int maxTailEntries = 1000;
+    static constexpr int drainIntervalMs = 25;
+
+    Logger()
+        : ring (std::make_unique<Slot[]> ((size_t) ringCapacity))
+    {
+        for (int i = 0; i < ringCapacity; ++i)
+            ring[(size_t) i].sequence.store ((std::uint64_t) i, std::memory_order_relaxed);
+
+        drainThread = std::thread ([this]
+        {
+            while (! drainThreadShouldExit.load (std::memory_order_acquire))
+            {
+                std::this_thread::sleep_for (std::chrono::milliseconds (drainIntervalMs));
+                flush();
+            }
+        });
+    }
+
+    ~Logger()
+    {
+        drainThreadShouldExit.store (true, std::memory_order_release);
+        drainThread.join();
+        flush();
+    }
 
     Logger (const Logger&) = delete;
     Logger& operator= (const Logger&) = delete;
     Logger (Logger&&) = delete;
     Logger& operator= (Logger&&) = delete;
 
+    // Any thread, never blocks; the String itself is the caller's allocation.
     void log (LogLevel level, const juce::String& message)
     {
-        std::lock_guard<std::mutex> lock (mutex);
-        entries.push_back ({ juce::Time::getCurrentTime(), level, message });
-        totalCount.fetch_add (1, std::memory_order_relaxed);
+        if (auto* slot = claimSlot())
+        {
+            auto& r = slot->record;
+            fillHeader (r, level, nullptr);
+
+            const auto* utf8 = message.toRawUTF8();
+            const auto fullLength = std::strlen (utf8);
+            auto length = juce::jmin ((size_t) maxTextBytes - 1, fullLength);
+
+            // Don't cut a multi-byte character in half
+            while (length > 0 && length < fullLength && (utf8[length] & 0xc0) == 0x80)
+                --length;
+
+            std::memcpy (r.text, utf8, length);
+            r.text[length] = 0;
 
-        juce::Logger::outputDebugString (message);
+            publish (*slot);
+        }
     }
 
+    // Real-time safe: formatting happens on the drain thread. format and any
+    // const char* arguments must outlive the drain (use string literals).
+    template <typename... Args>
+    void logDeferred (LogLevel level, const char* format, Args... args) noexcept
+    {
+        static_assert (sizeof... (Args) <= (size_t) maxArgs, "Too many log arguments");
+
+        if (auto* slot = claimSlot())
+        {
+            auto& r = slot->record;
+            fillHeader (r, level, format);
+            r.numArgs = 0;
+            (storeArg (r, args), ...);
+            publish (*slot);
+        }
+    }
+
+    // Also writes every drained entry to file, rotating it to file.1, file.2,
+    // ... (keeping maxBackups) once it exceeds maxBytes. Pass File() to stop.
+    void setFileSink (const juce::File& file, juce::int64 maxBytes = 4 * 1024 * 1024, int maxBackups = 3)
+    {
+        const std::lock_guard<std::mutex> lock (sinkMutex);
+        sink.reset();
+        sinkFile = file;
+        sinkMaxBytes = juce::jmax ((juce::int64) 1024, maxBytes);
+        sinkMaxBackups = juce::jmax (0, maxBackups);
+    }
+
+    // The newest entries, oldest first (at most maxTailEntries).
     std::vector<Logger::LogEntry> getSnapshot() const
     {
-        std::lock_guard<std::mutex> lock (mutex);
-        return entries;
+        std::lock_guard<std::mutex> lock (tailMutex);
+        return { tail.begin(), tail.end() };
     }
 
     int getTotalCount() const
@@ -44,8 +137,247 @@ public:
         return totalCount.load (std::memory_order_relaxed);
     }
 
+    // Records lost because the ring was full.
+    std::uint64_t getDroppedCount() const noexcept
+    {
+        return droppedCount.load (std::memory_order_relaxed);
+    }
+
+    // Drains and formats everything logged so far. Called by the drain
+    // thread; call it directly to make entries visible immediately (e.g.
+    // before reading getSnapshot() in a tool). Not from the audio thread.
+    void flush()
+    {
+        const std::lock_guard<std::mutex> drainLock (drainMutex);
+
+        for (;;)
+        {
+            auto& slot = ring[(size_t) (readPosition & (ringCapacity - 1))];
+            if (slot.sequence.load (std::memory_order_acquire) != readPosition + 1)
+                break;
+
+            const LogEntry entry { juce::Time (slot.record.timeMs), slot.record.level, format (slot.record) };
+            slot.sequence.store (readPosition + (std::uint64_t) ringCapacity, std::memory_order_release);
+            ++readPosition;
+
+            deliver (entry);
+        }
+
+        if (const auto dropped = droppedCount.load (std::memory_order_relaxed); dropped != reportedDropped)
+        {
+            deliver ({ juce::Time::getCurrentTime(), LogLevel::Warning,
+                       juce::String ((juce::int64) (dropped - reportedDropped)) + " log message(s) dropped (log ring full)" });
+            reportedDropped = dropped;
+        }
+    }
+
 private:
-    mutable std::mutex mutex;
-    std::vector<Logger::LogEntry> entries;
+    struct Arg
+    {
+        enum class Type : std::uint8_t { Int, Double, Text };
+
+        Type type = Type::Int;
+        union
+        {
+            std::int64_t i;
+            double d;
+            const char* s;
+        };
+    };
+
+    struct Record
+    {
+        juce::int64 timeMs = 0;
+        LogLevel level = LogLevel::Info;
+        const char* format = nullptr; // null: message is in text
+        std::array<Arg, (size_t) maxArgs> args {};
+        int numArgs = 0;
+        char text[maxTextBytes] {};
+    };
+
+    struct Slot
+    {
+        std::atomic<std::uint64_t> sequence { 0 };
+        Record record;
+    };
+
+    Slot* claimSlot() noexcept
+    {
+        auto position = writePosition.load (std::memory_order_relaxed);
+
+        for (;;)
+        {
+            auto& slot = ring[(size_t) (position & (ringCapacity - 1))];
+            const auto sequence = slot.sequence.load (std::memory_order_acquire);
+
+            if (sequence == position)
+            {
+                if (writePosition.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+                    return &slot;
+            }
+            else if (sequence < position)
+            {
+                droppedCount.fetch_add (1, std::memory_order_relaxed);
+                return nullptr; // full
+            }
+            else
+            {
+                position = writePosition.load (std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void publish (Slot& slot) noexcept
+    {
+        totalCount.fetch_add (1, std::memory_order_relaxed);
+        const auto position = slot.sequence.load (std::memory_order_relaxed);
+        slot.sequence.store (position + 1, std::memory_order_release);
+    }
+
+    static void fillHeader (Record& r, LogLevel level, const char* format) noexcept
+    {
+        r.timeMs = juce::Time::currentTimeMillis();
+        r.level = level;
+        r.format = format;
+    }
+
+    template <typename T>
+    static void storeArg (Record& r, T value) noexcept
+    {
+        auto& a = r.args[(size_t) r.numArgs++];
+
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            a.type = Arg::Type::Double;
+            a.d = (double) value;
+        }
+        else if constexpr (std::is_convertible_v<T, const char*>)
+        {
+            a.type = Arg::Type::Text;
+            a.s = value;
+        }
+        else
+        {
+            static_assert (std::is_integral_v<T> || std::is_enum_v<T>, "logDeferred takes numbers and string literals");
+            a.type = Arg::Type::Int;
+            a.i = (std::int64_t) value;
+        }
+    }
+
+    static juce::String format (const Record& r)
+    {
+        if (r.format == nullptr)
+            return juce::String::fromUTF8 (r.text);
+
+        juce::String result;
+        const char* literal = r.format;
+        int next = 0;
+
+        for (const char* p = r.format; *p != 0; ++p)
+        {
+            if (p[0] != '{' || p[1] != '}' || next >= r.numArgs)
+                continue;
+
+            result << juce::String::fromUTF8 (literal, (int) (p - literal));
+
+            const auto& a = r.args[(size_t) next++];
+
+            switch (a.type)
+            {
+                case Arg::Type::Int:    result << juce::String ((juce::int64) a.i); break;
+                case Arg::Type::Double: result << juce::String (a.d, 3); break;
+                case Arg::Type::Text:   result << juce::String::fromUTF8 (a.s); break;
+            }
+
+            literal = ++p + 1;
+        }
+
+        return result + juce::String::fromUTF8 (literal);
+    }
+
+    // Drain thread (or flush()), drainMutex held.
+    void deliver (const LogEntry& entry)
+    {
+        {
+            std::lock_guard<std::mutex> lock (tailMutex);
+            tail.push_back (entry);
+            while (tail.size() > (size_t) maxTailEntries)
+                tail.pop_front();
+        }
+
+        juce::Logger::outputDebugString (entry.message);
+        writeToSink (entry);
+    }
+
+    void writeToSink (const LogEntry& entry)
+    {
+        const std::lock_guard<std::mutex> lock (sinkMutex);
+        if (sinkFile == juce::File())
+            return;
+
+        if (sink != nullptr && sink->getPosition() > sinkMaxBytes)
+        {
+            sink.reset();
+            rotateSinkFiles();
+        }
+
+        if (sink == nullptr)
+        {
+            sink = std::make_unique<juce::FileOutputStream> (sinkFile);
+            if (! sink->openedOk())
+            {
+                sink.reset();
+                return;
+            }
+        }
+
+        static const char* const levelNames[] { "DEBUG", "INFO", "WARNING", "ERROR" };
+
+        *sink << entry.time.toISO8601 (true) << " " << levelNames[(int) entry.level] << " " << entry.message << "\n";
+        sink->flush();
+    }
+
+    // file.log -> file.1.log -> ... -> file.<maxBackups>.log (deleted)
+    void rotateSinkFiles()
+    {
+        auto backup = [this] (int index)
+        {
+            return sinkFile.getSiblingFile (sinkFile.getFileNameWithoutExtension() + "." + juce::String (index)
+                                            + sinkFile.getFileExtension());
+        };
+
+        if (sinkMaxBackups == 0)
+        {
+            sinkFile.deleteFile();
+            return;
+        }
+
+        backup (sinkMaxBackups).deleteFile();
+
+        for (int i = sinkMaxBackups - 1; i >= 1; --i)
+            backup (i).moveFileTo (backup (i + 1));
+
+        sinkFile.moveFileTo (backup (1));
+    }
+
+    std::unique_ptr<Slot[]> ring;
+    std::atomic<std::uint64_t> writePosition { 0 };
+    std::uint64_t readPosition = 0; // drainMutex
+    std::atomic<std::uint64_t> droppedCount { 0 };
+    std::uint64_t reportedDropped = 0; // drainMutex
     std::atomic<int> totalCount { 0 };
+
+    std::mutex drainMutex;
+
+    mutable std::mutex tailMutex;
+    std::deque<LogEntry> tail;
+
+    std::mutex sinkMutex;
+    juce::File sinkFile;
+    std::unique_ptr<juce::FileOutputStream> sink;
+    juce::int64 sinkMaxBytes = 4 * 1024 * 1024;
+    int sinkMaxBackups = 3;
+
+    std::atomic<bool> drainThreadShouldExit { false };
+    std::thread drainThread;
 };
@@ -1,16 +1,161 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "HardwareCounters.h"
+#include "LatencyHistogram.h"
 #include "Logger.h"
+#include "TraceRecorder.h"
 
+// Per-stage timers (ScopedStage and the ORCHESTRASYNTH_TIME_* macros below).
+// Build with ORCHESTRASYNTH_STAGE_TIMING=0 to compile them out entirely.
+#ifndef ORCHESTRASYNTH_STAGE_TIMING
+ #define ORCHESTRASYNTH_STAGE_TIMING 1
+#endif
+
+// Audio-block timing. The audio thread calls beginBlock()/endBlock() around
+// every block; that path is a few relaxed atomics and two histogram
+// increments, never a lock.
+//
+// Two histograms are kept: block time in microseconds, and load (block time
+// over the block's real-time budget, numSamples / sampleRate) in units of
+// 1/1000. A block whose time exceeds its budget counts as an overrun - the
+// callback missed its deadline and the host very likely dropped out.
+//
+// Percentiles and overruns in the snapshot cover the current window, which
+// starts at beginSession() or the last resetWindow(). Snapshots and window
+// resets are for non-audio threads; they take a lock only against each other.
+//
+// Inside the block, named stages (and per-section sub-stages) are timed with
+// ScopedStage on std::chrono::steady_clock: two clock reads and three relaxed
+// atomics per stage, no allocation. Per-stage totals are kept, not
+// histograms; resetWindow() zeroes them, so a block in flight at that moment
+// may land half in either window.
+//
+// A session started with a trace file also captures blocks, stages, overruns
+// and whatever else is recorded through getTraceRecorder() into a
+// TraceRecorder, written as Chrome trace JSON by endSession() (or any time
+// with writeTrace()).
+//
+// Optionally (setHardwareCountersEnabled()), CPU counters for the audio
+// thread are read at beginBlock()/endBlock() and summed per window: IPC, and
+// cycles and misses per voice-sample (active voices x samples, as passed to
+// endBlock()). The counters are opened on the audio thread by its first
+// beginBlock() after enabling - a few syscalls, once - and reopened if the
+// host moves the callback to another thread. Each measured block then costs
+// two read() syscalls. Where perf events are not permitted or not supported
+// the snapshot reports that and nothing else changes.
 class PerformanceMonitor
 {
 public:
+    // Top-level stages of OrchestraSynthEngine::processBlock
+    enum class Stage
+    {
+        PullParams,     // section params + voice limits
+        RouteMidi,      // host + virtual MIDI into the section queues
+        RenderSections, // all sections, serial or parallel (wall time)
+        MixBuses,       // dry bus sum and reverb sends
+        Reverb,         // convolution reverb
+        numStages
+    };
+
+    // Per-section sub-stages of RenderSections. Skipped (silent) sections
+    // record nothing. Bus minus Voices and Saturation is the oversampling
+    // filters, latency compensation and gain/pan.
+    enum class SectionStage
+    {
+        Bus,            // the whole section
+        Voices,         // voice bank render, at the oversampled rate
+        Saturation,     // drive stage, at the oversampled rate
+        numSectionStages
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int maxSections = 8;
+    static constexpr int numStages = (int) Stage::numStages;
+    static constexpr int numSectionStages = (int) SectionStage::numSectionStages;
+
+    struct StageStatsSnapshot
+    {
+        std::uint64_t calls = 0;
+        double meanUs = 0.0;
+        double maxUs = 0.0;
+        double lastUs = 0.0;
+    };
+
+    // Times its scope into one stage slot. Use the macros below so builds
+    // without ORCHESTRASYNTH_STAGE_TIMING pay nothing.
+    class ScopedStage
+    {
+    public:
+        ScopedStage (PerformanceMonitor& monitorIn, Stage stage) noexcept
+            : monitor (monitorIn), slot ((int) stage), name (getStageName (stage))
+        {
+            monitor.trace.beginSpan (name);
+            start = Clock::now();
+        }
+
+        ScopedStage (PerformanceMonitor& monitorIn, SectionStage stage, int section) noexcept
+            : monitor (monitorIn),
+              slot (numStages + juce::jlimit (0, maxSections - 1, section) * numSectionStages + (int) stage),
+              name (getSectionStageName (stage))
+        {
+            monitor.trace.beginSpan (name, "section", section);
+            start = Clock::now();
+        }
+
+        ~ScopedStage()
+        {
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds> (Clock::now() - start).count();
+            monitor.recordStage (slot, (std::uint64_t) juce::jmax ((std::int64_t) 0, (std::int64_t) ns));
+            monitor.trace.endSpan (name);
+        }
+
+        ScopedStage (const ScopedStage&) = delete;
+        ScopedStage& operator= (const ScopedStage&) = delete;
+
+    private:
+        PerformanceMonitor& monitor;
+        int slot;
+        const char* name;
+        Clock::time_point start;
+    };
+
+    struct HardwareCounterSnapshot
+    {
+        bool enabled = false;
+        bool available = false;
+        juce::String status;        // why not available
+        std::uint64_t blocks = 0;   // blocks measured in this window
+        double ipc = 0.0;           // instructions per cycle
+        double cyclesPerVoiceSample = 0.0;
+        double l1dMissesPerVoiceSample = 0.0; // 0 if the counter is not supported
+        double llcMissesPerVoiceSample = 0.0;
+        double branchMissesPerVoiceSample = 0.0;
+    };
+
     struct BlockStatsSnapshot
     {
         double lastBlockMs = 0.0;
         double averageBlockMs = 0.0;
+
+        // Current window
+        std::uint64_t blocks = 0;
+        std::uint64_t overruns = 0;
+        double p50BlockMs = 0.0;
+        double p99BlockMs = 0.0;
+        double p999BlockMs = 0.0;
+        double maxBlockMs = 0.0;
+        double p50Load = 0.0;   // 1.0 = the whole real-time budget
+        double p99Load = 0.0;
+        double p999Load = 0.0;
+        double maxLoad = 0.0;
+        double windowSeconds = 0.0;
     };
 
     explicit PerformanceMonitor (Logger& loggerIn) : logger (loggerIn) {}
@@ -20,24 +165,74 @@ public:
     PerformanceMonitor (PerformanceMonitor&&) = delete;
     PerformanceMonitor& operator= (PerformanceMonitor&&) = delete;
 
-    void beginSession()
+    // With a trace file, also starts trace capture for the session.
+    void beginSession (const juce::File& traceFileIn = {})
     {
         running.store (true, std::memory_order_release);
         blockCount.store (0, std::memory_order_release);
         avgBlockMs.store (0.0, std::memory_order_release);
+        resetWindow();
+
+        traceFile = traceFileIn;
+        if (traceFile != juce::File())
+            trace.start();
     }
 
     void endSession()
     {
         running.store (false, std::memory_order_release);
+
+        if (! trace.isCapturing())
+            return;
+
+        trace.stop();
+        writeTrace (traceFile);
+    }
+
+    // Writes what the session's trace holds so far (message thread).
+    bool writeTrace (const juce::File& file)
+    {
+        if (! trace.writeChromeTrace (file))
+        {
+            logger.log (Logger::LogLevel::Warning, "Could not write trace: " + file.getFullPathName());
+            return false;
+        }
+
+        logger.log (Logger::LogLevel::Info, "Wrote trace: " + file.getFullPathName()
+                                            + " (" + juce::String ((juce::int64) trace.getNumDroppedEvents()) + " events dropped)");
+        return true;
+    }
+
+    // For engine-level trace events (counters, instants); records nothing
+    // unless a traced session is running.
+    TraceRecorder& getTraceRecorder() noexcept { return trace; }
+
+    // Sample rate the block budgets are computed from; call from prepare().
+    void setSampleRate (double newSampleRate)
+    {
+        if (newSampleRate > 0.0)
+            sampleRate.store (newSampleRate, std::memory_order_relaxed);
+    }
+
+    // Message thread. Takes effect at the next beginBlock().
+    void setHardwareCountersEnabled (bool shouldBeEnabled)
+    {
+        hardwareCountersRequested.store (shouldBeEnabled, std::memory_order_relaxed);
     }
 
     void beginBlock()
     {
+        trace.beginSpan ("block");
+
+        if (hardwareCountersRequested.load (std::memory_order_relaxed) || counters.isOpen())
+            updateHardwareCounters();
+
         blockStartTime = juce::Time::getMillisecondCounterHiRes();
     }
 
-    void endBlock (int /*samples*/)
+    // activeVoices: voices sounding in this block, for the per-voice-sample
+    // hardware counter figures (0 if unknown).
+    void endBlock (int samples, int activeVoices = 0)
     {
         const auto now = juce::Time::getMillisecondCounterHiRes();
         const auto ms = now - blockStartTime;
@@ -48,6 +243,120 @@ public:
         const auto prevAvg = avgBlockMs.load (std::memory_order_relaxed);
         const auto newAvg = prevAvg + (ms - prevAvg) / (double) n;
         avgBlockMs.store (newAvg, std::memory_order_relaxed);
+
+        blockTimes.record ((std::uint64_t) juce::jmax (0.0, ms * 1000.0));
+
+        if (samples > 0)
+        {
+            const auto budgetMs = 1000.0 * samples / sampleRate.load (std::memory_order_relaxed);
+            blockLoads.record ((std::uint64_t) juce::jmax (0.0, ms / budgetMs * loadScale));
+
+            if (ms > budgetMs)
+            {
+                overrunCount.fetch_add (1, std::memory_order_relaxed);
+                trace.instant ("overrun");
+            }
+        }
+
+        if (countersStarted)
+            accumulateHardwareCounters ((std::uint64_t) juce::jmax (0, samples) * (std::uint64_t) juce::jmax (0, activeVoices));
+
+        trace.endSpan ("block");
+    }
+
+    // Starts a new statistics window (any non-audio thread).
+    void resetWindow()
+    {
+        const std::lock_guard<std::mutex> lock (windowMutex);
+        blockTimes.getCounts (windowTimesBaseline);
+        blockLoads.getCounts (windowLoadsBaseline);
+        windowOverrunsBaseline = overrunCount.load (std::memory_order_relaxed);
+        windowStartMs = juce::Time::getMillisecondCounterHiRes();
+
+        for (auto& slot : stageSlots)
+        {
+            slot.calls.store (0, std::memory_order_relaxed);
+            slot.totalNs.store (0, std::memory_order_relaxed);
+            slot.maxNs.store (0, std::memory_order_relaxed);
+        }
+
+        for (auto& total : counterTotals)
+            total.store (0, std::memory_order_relaxed);
+
+        counterBlocks.store (0, std::memory_order_relaxed);
+        counterVoiceSamples.store (0, std::memory_order_relaxed);
+    }
+
+    HardwareCounterSnapshot getHardwareCounterSnapshot() const
+    {
+        HardwareCounterSnapshot s;
+        s.enabled = hardwareCountersRequested.load (std::memory_order_relaxed);
+        s.available = counterStatus.load (std::memory_order_relaxed) == 0;
+
+        if (! s.enabled)
+            s.status = "off";
+        else if (countersHaveOpened.load (std::memory_order_acquire) || ! s.available)
+            s.status = HardwareCounters::describeError (counterStatus.load (std::memory_order_relaxed));
+        else
+            s.status = "waiting for the audio thread";
+
+        auto total = [this] (HardwareCounters::Counter c)
+        {
+            return (double) counterTotals[(size_t) c].load (std::memory_order_relaxed);
+        };
+
+        s.blocks = counterBlocks.load (std::memory_order_relaxed);
+
+        const auto cycles = total (HardwareCounters::Cycles);
+        const auto voiceSamples = (double) counterVoiceSamples.load (std::memory_order_relaxed);
+
+        s.ipc = cycles > 0.0 ? total (HardwareCounters::Instructions) / cycles : 0.0;
+
+        if (voiceSamples > 0.0)
+        {
+            s.cyclesPerVoiceSample       = cycles / voiceSamples;
+            s.l1dMissesPerVoiceSample    = total (HardwareCounters::L1DReadMisses) / voiceSamples;
+            s.llcMissesPerVoiceSample    = total (HardwareCounters::LLCMisses) / voiceSamples;
+            s.branchMissesPerVoiceSample = total (HardwareCounters::BranchMisses) / voiceSamples;
+        }
+
+        return s;
+    }
+
+    static const char* getStageName (Stage stage) noexcept
+    {
+        switch (stage)
+        {
+            case Stage::PullParams:     return "pullParams";
+            case Stage::RouteMidi:      return "routeMidi";
+            case Stage::RenderSections: return "renderSections";
+            case Stage::MixBuses:       return "mixBuses";
+            case Stage::Reverb:         return "reverb";
+            case Stage::numStages:
+            default:                    return "";
+        }
+    }
+
+    static const char* getSectionStageName (SectionStage stage) noexcept
+    {
+        switch (stage)
+        {
+            case SectionStage::Bus:        return "bus";
+            case SectionStage::Voices:     return "voices";
+            case SectionStage::Saturation: return "saturation";
+            case SectionStage::numSectionStages:
+            default:                       return "";
+        }
+    }
+
+    StageStatsSnapshot getStageSnapshot (Stage stage) const
+    {
+        return getSlotSnapshot ((int) stage);
+    }
+
+    StageStatsSnapshot getSectionStageSnapshot (int section, SectionStage stage) const
+    {
+        return getSlotSnapshot (numStages + juce::jlimit (0, maxSections - 1, section) * numSectionStages + (int) stage);
     }
 
     BlockStatsSnapshot getSnapshot() const
@@ -55,14 +364,160 @@ public:
         BlockStatsSnapshot s;
         s.lastBlockMs = lastBlockMs.load (std::memory_order_relaxed);
         s.averageBlockMs = avgBlockMs.load (std::memory_order_relaxed);
+
+        const std::lock_guard<std::mutex> lock (windowMutex);
+
+        blockTimes.getCounts (scratchCounts);
+        const auto times = LatencyHistogram::summarise (scratchCounts, &windowTimesBaseline);
+        blockLoads.getCounts (scratchCounts);
+        const auto loads = LatencyHistogram::summarise (scratchCounts, &windowLoadsBaseline);
+
+        s.blocks = times.count;
+        s.overruns = overrunCount.load (std::memory_order_relaxed) - windowOverrunsBaseline;
+        s.p50BlockMs  = (double) times.p50 * 0.001;
+        s.p99BlockMs  = (double) times.p99 * 0.001;
+        s.p999BlockMs = (double) times.p999 * 0.001;
+        s.maxBlockMs  = (double) times.max * 0.001;
+        s.p50Load  = (double) loads.p50 / loadScale;
+        s.p99Load  = (double) loads.p99 / loadScale;
+        s.p999Load = (double) loads.p999 / loadScale;
+        s.maxLoad  = (double) loads.max / loadScale;
+        s.windowSeconds = (juce::Time::getMillisecondCounterHiRes() - windowStartMs) * 0.001;
         return s;
     }
 
 private:
+    static constexpr double loadScale = 1000.0; // load histogram units per 1.0
+    static constexpr int numStageSlots = numStages + maxSections * numSectionStages;
+
+    // One writer per slot at a time (sections may move between render threads
+    // from block to block, never within one).
+    struct StageSlot
+    {
+        std::atomic<std::uint64_t> calls { 0 };
+        std::atomic<std::uint64_t> totalNs { 0 };
+        std::atomic<std::uint64_t> maxNs { 0 };
+        std::atomic<std::uint64_t> lastNs { 0 };
+    };
+
+    void recordStage (int slotIndex, std::uint64_t ns) noexcept
+    {
+        auto& slot = stageSlots[(size_t) slotIndex];
+        slot.calls.fetch_add (1, std::memory_order_relaxed);
+        slot.totalNs.fetch_add (ns, std::memory_order_relaxed);
+        slot.lastNs.store (ns, std::memory_order_relaxed);
+
+        if (ns > slot.maxNs.load (std::memory_order_relaxed))
+            slot.maxNs.store (ns, std::memory_order_relaxed);
+    }
+
+    StageStatsSnapshot getSlotSnapshot (int slotIndex) const
+    {
+        const auto& slot = stageSlots[(size_t) slotIndex];
+
+        StageStatsSnapshot s;
+        s.calls = slot.calls.load (std::memory_order_relaxed);
+        s.meanUs = s.calls > 0 ? (double) slot.totalNs.load (std::memory_order_relaxed) * 0.001 / (double) s.calls : 0.0;
+        s.maxUs = (double) slot.maxNs.load (std::memory_order_relaxed) * 0.001;
+        s.lastUs = (double) slot.lastNs.load (std::memory_order_relaxed) * 0.001;
+        return s;
+    }
+
     Logger& logger;
     std::atomic<bool> running { false };
     std::atomic<double> lastBlockMs { 0.0 };
     std::atomic<double> avgBlockMs { 0.0 };
     std::atomic<int> blockCount { 0 };
+    std::atomic<double> sampleRate { 44100.0 };
     double blockStartTime = 0.0;
+
+    LatencyHistogram blockTimes; // microseconds
+    LatencyHistogram blockLoads; // loadScale units
+    std::atomic<std::uint64_t> overrunCount { 0 };
+
+    // Reader side only
+    mutable std::mutex windowMutex;
+    LatencyHistogram::Counts windowTimesBaseline {};
+    LatencyHistogram::Counts windowLoadsBaseline {};
+    mutable LatencyHistogram::Counts scratchCounts {};
+    std::uint64_t windowOverrunsBaseline = 0;
+    double windowStartMs = juce::Time::getMillisecondCounterHiRes();
+
+    std::array<StageSlot, (size_t) numStageSlots> stageSlots {};
+
+    TraceRecorder trace;
+    juce::File traceFile;
+
+    // Audio thread: opens, reopens or closes the counters as requested, then
+    // takes the block's starting reading.
+    void updateHardwareCounters() noexcept
+    {
+        countersStarted = false;
+        const auto requested = hardwareCountersRequested.load (std::memory_order_relaxed);
+        const auto self = std::this_thread::get_id();
+
+        if (! requested || (counters.isOpen() && countersThread != self))
+            counters.close();
+
+        if (! requested)
+        {
+            counterStatus.store (0, std::memory_order_relaxed);
+            countersHaveOpened.store (false, std::memory_order_relaxed);
+            return;
+        }
+
+        if (! counters.isOpen())
+        {
+            // A thread that already failed does not retry every block
+            if (countersThread == self && counterStatus.load (std::memory_order_relaxed) != 0)
+                return;
+
+            countersThread = self;
+            const auto ok = counters.open();
+            counterStatus.store (ok ? 0 : juce::jmax (1, counters.getLastError()), std::memory_order_relaxed);
+            countersHaveOpened.store (true, std::memory_order_release);
+
+            if (! ok)
+                return;
+        }
+
+        countersStarted = counters.read (countersAtBlockStart);
+    }
+
+    void accumulateHardwareCounters (std::uint64_t voiceSamples) noexcept
+    {
+        HardwareCounters::Values now;
+        if (! counters.read (now))
+            return;
+
+        for (size_t c = 0; c < now.size(); ++c)
+            if (now[c] > countersAtBlockStart[c])
+                counterTotals[c].fetch_add (now[c] - countersAtBlockStart[c], std::memory_order_relaxed);
+
+        counterBlocks.fetch_add (1, std::memory_order_relaxed);
+        counterVoiceSamples.fetch_add (voiceSamples, std::memory_order_relaxed);
+    }
+
+    // Audio thread only
+    HardwareCounters counters;
+    HardwareCounters::Values countersAtBlockStart {};
+    std::thread::id countersThread;
+    bool countersStarted = false;
+
+    std::atomic<bool> hardwareCountersRequested { false };
+    std::atomic<bool> countersHaveOpened { false };
+    std::atomic<int> counterStatus { 0 }; // errno of the last failed open, 0 = ok
+    std::array<std::atomic<std::uint64_t>, (size_t) HardwareCounters::numCounters> counterTotals {};
+    std::atomic<std::uint64_t> counterBlocks { 0 };
+    std::atomic<std::uint64_t> counterVoiceSamples { 0 };
 };
+
+#if ORCHESTRASYNTH_STAGE_TIMING
+ #define ORCHESTRASYNTH_TIME_STAGE(monitor, stage) \
+    PerformanceMonitor::ScopedStage JUCE_JOIN_MACRO (stageTimer_, __LINE__) (monitor, PerformanceMonitor::Stage::stage)
+ #define ORCHESTRASYNTH_TIME_SECTION_STAGE(monitor, stage, section) \
+    PerformanceMonitor::ScopedStage JUCE_JOIN_MACRO (stageTimer_, __LINE__) (monitor, PerformanceMonitor::SectionStage::stage, section)
+#else
+ #define ORCHESTRASYNTH_TIME_STAGE(monitor, stage)
+ #define ORCHESTRASYNTH_TIME_SECTION_STAGE(monitor, stage, section)
+#endif
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Process-wide, reference-counted cache of immutable resources (decoded
+// audio files, partitioned IR spectra, ...), one per Value type.
+//
+// Every plugin instance in a host process shares the same cache, so a hall
+// or sample set used by 30 instances is decoded, resampled and partitioned
+// once and shared read-only. Entries are held weakly: a resource lives
+// exactly as long as some instance still uses it.
+//
+// Concurrent requests for the same key build it once; the other callers
+// block until that build finishes. Builders run outside the cache lock, so
+// unrelated keys load in parallel. Never call from the audio thread.
+template <typename Value>
+class SharedResourceCache
+{
+public:
+    using Pointer = std::shared_ptr<const Value>;
+    using Builder = std::function<Pointer()>;
+
+    struct CacheSnapshot
+    {
+        int numEntries = 0;     // keys currently alive or being built
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+    };
+
+    static SharedResourceCache& getInstance()
+    {
+        static SharedResourceCache instance;
+        return instance;
+    }
+
+    SharedResourceCache (const SharedResourceCache&) = delete;
+    SharedResourceCache& operator= (const SharedResourceCache&) = delete;
+    SharedResourceCache (SharedResourceCache&&) = delete;
+    SharedResourceCache& operator= (SharedResourceCache&&) = delete;
+
+    // Returns the cached value for key, or runs build() to create it. A null
+    // result (e.g. unreadable file) is returned but not cached. If build()
+    // throws, the exception reaches this caller and any waiting ones.
+    Pointer getOrCreate (const juce::String& key, const Builder& build)
+    {
+        std::promise<Pointer> promise;
+
+        {
+            std::unique_lock<std::mutex> lock (mutex);
+            auto& entry = entries[key];
+
+            if (auto existing = entry.value.lock())
+            {
+                hits.fetch_add (1, std::memory_order_relaxed);
+                return existing;
+            }
+
+            if (entry.pending.valid())
+            {
+                auto pending = entry.pending;
+                lock.unlock();
+                hits.fetch_add (1, std::memory_order_relaxed);
+                return pending.get();
+            }
+
+            misses.fetch_add (1, std::memory_order_relaxed);
+            entry.pending = promise.get_future().share();
+            pruneExpired (key);
+        }
+
+        Pointer value;
+
+        try
+        {
+            value = build();
+        }
+        catch (...)
+        {
+            // Waiters get the same exception; the next request builds again.
+            finishPending (key, nullptr);
+            promise.set_exception (std::current_exception());
+            throw;
+        }
+
+        finishPending (key, value);
+        promise.set_value (value);
+        return value;
+    }
+
+    // Identifies a file's content by path, size and modification time, so an
+    // edited file is reloaded rather than served stale.
+    static juce::String makeFileKey (const juce::File& file)
+    {
+        return file.getFullPathName()
+             + "|" + juce::String (file.getSize())
+             + "|" + juce::String (file.getLastModificationTime().toMilliseconds());
+    }
+
+    CacheSnapshot getSnapshot() const
+    {
+        CacheSnapshot s;
+
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+            for (const auto& [key, entry] : entries)
+                if (! entry.value.expired() || entry.pending.valid())
+                    ++s.numEntries;
+        }
+
+        s.hits = hits.load (std::memory_order_relaxed);
+        s.misses = misses.load (std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    SharedResourceCache() = default;
+
+    struct Entry
+    {
+        std::weak_ptr<const Value> value;
+        std::shared_future<Pointer> pending; // valid while a build is in flight
+    };
+
+    void finishPending (const juce::String& key, const Pointer& value)
+    {
+        const std::lock_guard<std::mutex> lock (mutex);
+        auto& entry = entries[key];
+        entry.value = value;
+        entry.pending = {};
+    }
+
+    // Called with the lock held. Drops keys nobody references any more.
+    void pruneExpired (const juce::String& keep)
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->first != keep && it->second.value.expired() && ! it->second.pending.valid())
+                it = entries.erase (it);
+            else
+                ++it;
+        }
+    }
+
+    mutable std::mutex mutex;
+    std::map<juce::String, Entry> entries;
+    std::atomic<std::uint64_t> hits { 0 };
+    std::atomic<std::uint64_t> misses { 0 };
+};
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Real-time trace capture, written out as Chrome Trace Event JSON (opens in
+// chrome://tracing and ui.perfetto.dev).
+//
+// Each recording thread (audio callback, render pool workers) claims one of
+// maxThreads single-producer rings the first time it records, so recording
+// is a thread_local lookup, a clock read and one slot write: no locks, no
+// allocation. A full ring drops the event and counts it. Events carry names
+// and argument names as const char* - they must be string literals or
+// otherwise outlive the capture.
+//
+// While capturing, a background thread drains the rings every drainIntervalMs
+// into a bounded in-memory list (at most maxStoredBytes of events), which
+// writeChromeTrace() serialises. Rings are allocated by start(), on the
+// calling thread.
+//
+// start()/stop()/writeChromeTrace() on the message thread; the record
+// functions from anywhere, and they do nothing unless capturing.
+class TraceRecorder
+{
+public:
+    static constexpr int maxThreads = 16;
+    static constexpr int ringCapacity = 1 << 14;  // events per thread between drains
+    static constexpr int maxArgs = 4;
+    static constexpr int drainIntervalMs = 20;
+    static constexpr size_t maxStoredBytes = 128u << 20; // a few minutes of a busy session
+
+    TraceRecorder() = default;
+
+    ~TraceRecorder()
+    {
+        stop();
+    }
+
+    TraceRecorder (const TraceRecorder&) = delete;
+    TraceRecorder& operator= (const TraceRecorder&) = delete;
+    TraceRecorder (TraceRecorder&&) = delete;
+    TraceRecorder& operator= (TraceRecorder&&) = delete;
+
+    void start()
+    {
+        stop();
+
+        {
+            const std::lock_guard<std::mutex> lock (storedMutex);
+            stored.clear();
+            threadSeen.fill (false);
+        }
+
+        for (auto& ring : rings)
+        {
+            if (ring.events == nullptr)
+                ring.events = std::make_unique<Event[]> ((size_t) ringCapacity);
+
+            ring.owner.store (std::thread::id(), std::memory_order_relaxed);
+            ring.head.store (0, std::memory_order_relaxed);
+            ring.tail.store (0, std::memory_order_relaxed);
+        }
+
+        dropped.store (0, std::memory_order_relaxed);
+        sessionStart = Clock::now();
+        captureId.store (nextCaptureId().fetch_add (1, std::memory_order_relaxed), std::memory_order_relaxed);
+        capturing.store (true, std::memory_order_release);
+
+        drainThreadShouldExit.store (false, std::memory_order_relaxed);
+        drainThread = std::thread ([this]
+        {
+            while (! drainThreadShouldExit.load (std::memory_order_relaxed))
+            {
+                std::this_thread::sleep_for (std::chrono::milliseconds (drainIntervalMs));
+                drain();
+            }
+        });
+    }
+
+    // Stops recording and collects whatever is left in the rings.
+    void stop()
+    {
+        capturing.store (false, std::memory_order_release);
+
+        if (drainThread.joinable())
+        {
+            drainThreadShouldExit.store (true, std::memory_order_relaxed);
+            drainThread.join();
+        }
+
+        drain();
+    }
+
+    bool isCapturing() const noexcept
+    {
+        return capturing.load (std::memory_order_relaxed);
+    }
+
+    // Events lost to full rings or the stored-event limit.
+    std::uint64_t getNumDroppedEvents() const noexcept
+    {
+        return dropped.load (std::memory_order_relaxed);
+    }
+
+    // Span start/end on the calling thread (Chrome "B"/"E").
+    void beginSpan (const char* name, const char* argName = nullptr, int argValue = 0) noexcept
+    {
+        if (isCapturing())
+            record ('B', name, &argName, &argValue, argName != nullptr ? 1 : 0);
+    }
+
+    void endSpan (const char* name) noexcept
+    {
+        if (isCapturing())
+            record ('E', name, nullptr, nullptr, 0);
+    }
+
+    // A point event on the calling thread (Chrome "i").
+    void instant (const char* name) noexcept
+    {
+        if (isCapturing())
+            record ('i', name, nullptr, nullptr, 0);
+    }
+
+    // Up to maxArgs named series plotted as one counter track (Chrome "C").
+    void counter (const char* name, std::initializer_list<const char*> argNames,
+                  std::initializer_list<int> values) noexcept
+    {
+        if (isCapturing())
+            record ('C', name, argNames.begin(), values.begin(), (int) juce::jmin (argNames.size(), values.size()));
+    }
+
+    // Drains everything recorded so far and writes it; can be called while
+    // capturing. Returns false if the file could not be written.
+    bool writeChromeTrace (const juce::File& file)
+    {
+        drain();
+
+        juce::FileOutputStream out (file);
+        if (! out.openedOk())
+            return false;
+
+        out.setPosition (0);
+        out.truncate();
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        bool first = true;
+        auto separator = [&out, &first]
+        {
+            if (! first)
+                out << ",\n";
+            first = false;
+        };
+
+        {
+            const std::lock_guard<std::mutex> lock (storedMutex);
+
+            // Threads are numbered in the order they first recorded; the audio
+            // callback is normally thread 0.
+            for (int t = 0; t < maxThreads; ++t)
+            {
+                if (! threadSeen[(size_t) t])
+                    continue;
+
+                separator();
+                out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << t
+                    << ",\"args\":{\"name\":\"thread " << t << "\"}}";
+            }
+
+            for (const auto& e : stored)
+            {
+                separator();
+                out << "{\"ph\":\"" << e.phase
+                    << "\",\"name\":\"" << e.name
+                    << "\",\"pid\":1,\"tid\":" << (int) e.thread
+                    << ",\"ts\":" << juce::String ((double) e.timeNs * 0.001, 3);
+
+                if (e.phase == 'i')
+                    out << ",\"s\":\"t\"";
+
+                if (e.numArgs > 0)
+                {
+                    out << ",\"args\":{";
+                    for (int a = 0; a < e.numArgs; ++a)
+                        out << (a > 0 ? "," : "") << "\"" << e.argNames[a] << "\":" << e.args[a];
+                    out << "}";
+                }
+
+                out << "}";
+            }
+        }
+
+        out << "\n]}\n";
+        out.flush();
+        return ! out.getStatus().failed();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event
+    {
+        std::uint64_t timeNs = 0; // since start()
+        const char* name = "";
+        std::array<const char*, (size_t) maxArgs> argNames {};
+        std::array<int, (size_t) maxArgs> args {};
+        std::uint8_t numArgs = 0;
+        std::uint8_t thread = 0;
+        char phase = 'i';
+    };
+
+    // Single producer (the owning thread), single consumer (drain()).
+    struct Ring
+    {
+        std::unique_ptr<Event[]> events;
+        std::atomic<std::thread::id> owner {};
+        std::atomic<std::uint32_t> head { 0 }; // next write, producer
+        std::atomic<std::uint32_t> tail { 0 }; // next read, consumer
+    };
+
+    void record (char phase, const char* name, const char* const* argNames, const int* values, int numArgs) noexcept
+    {
+        auto* ring = getRingForThisThread();
+        if (ring == nullptr)
+        {
+            dropped.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        const auto head = ring->head.load (std::memory_order_relaxed);
+        if (head - ring->tail.load (std::memory_order_acquire) >= (std::uint32_t) ringCapacity)
+        {
+            dropped.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto& e = ring->events[head & (ringCapacity - 1)];
+        e.timeNs = (std::uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (Clock::now() - sessionStart).count();
+        e.name = name;
+        e.phase = phase;
+        e.thread = (std::uint8_t) (ring - rings.data());
+        e.numArgs = (std::uint8_t) juce::jlimit (0, maxArgs, numArgs);
+
+        for (int a = 0; a < e.numArgs; ++a)
+        {
+            e.argNames[(size_t) a] = argNames[a];
+            e.args[(size_t) a] = values[a];
+        }
+
+        ring->head.store (head + 1, std::memory_order_release);
+    }
+
+    // Process-wide, so a cached ring can't match a different recorder that
+    // happens to live at the same address, or an earlier capture.
+    static std::atomic<std::uint64_t>& nextCaptureId() noexcept
+    {
+        static std::atomic<std::uint64_t> id { 1 };
+        return id;
+    }
+
+    Ring* getRingForThisThread() noexcept
+    {
+        struct Cache
+        {
+            std::uint64_t captureId = 0; // 0 never matches: IDs start at 1
+            Ring* ring = nullptr;
+        };
+
+        thread_local Cache cache;
+        const auto currentCapture = captureId.load (std::memory_order_relaxed);
+
+        if (cache.captureId == currentCapture)
+            return cache.ring;
+
+        // First event from this thread in this capture: claim a free ring.
+        const auto self = std::this_thread::get_id();
+        Ring* claimed = nullptr;
+
+        for (auto& ring : rings)
+        {
+            auto expected = std::thread::id();
+            if (ring.owner.load (std::memory_order_relaxed) == self
+                || ring.owner.compare_exchange_strong (expected, self, std::memory_order_acq_rel))
+            {
+                claimed = &ring;
+                break;
+            }
+        }
+
+        cache = { currentCapture, claimed };
+        return claimed;
+    }
+
+    void drain()
+    {
+        const std::lock_guard<std::mutex> lock (storedMutex);
+
+        for (auto& ring : rings)
+        {
+            if (ring.events == nullptr)
+                continue;
+
+            const auto head = ring.head.load (std::memory_order_acquire);
+            auto tail = ring.tail.load (std::memory_order_relaxed);
+
+            for (; tail != head; ++tail)
+            {
+                const auto& e = ring.events[tail & (ringCapacity - 1)];
+                threadSeen[(size_t) e.thread] = true;
+
+                if (stored.size() < maxStoredBytes / sizeof (Event))
+                    stored.push_back (e);
+                else
+                    dropped.fetch_add (1, std::memory_order_relaxed);
+            }
+
+            ring.tail.store (tail, std::memory_order_release);
+        }
+    }
+
+    std::array<Ring, (size_t) maxThreads> rings;
+    std::atomic<bool> capturing { false };
+    std::atomic<std::uint64_t> captureId { 0 }; // from nextCaptureId(), set by start()
+    std::atomic<std::uint64_t> dropped { 0 };
+    Clock::time_point sessionStart = Clock::now();
+
+    std::thread drainThread;
+    std::atomic<bool> drainThreadShouldExit { false };
+
+    std::mutex storedMutex;
+    std::vector<Event> stored;
+    std::array<bool, (size_t) maxThreads> threadSeen {};
+};
@@ -0,0 +1,583 @@
+#include <JuceHeader.h>
+
+#include "../../Engine/OrchestraSynthEngine.h"
+#include "../../Systems/Logger.h"
+#include "../../Systems/PerformanceMonitor.h"
+#include "../../Systems/PresetManager.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+
+// Engine benchmark suite.
+//
+// Each case renders blocks in a tight loop for a fixed wall-clock budget and
+// reports the median cost of five runs as ns per output sample, plus the
+// real-time factor (audio time / CPU time; > 1 means faster than real time).
+// Cases sweep one dimension at a time around a reference point
+// (512 samples, 48 kHz, 32 voices, 2 s IR):
+//
+//   voiceBank       SectionVoiceBank::render             block, rate, voices
+//   voiceFilter     render with filter modulation moving block, voices
+//   midiRouting     processBlock with 256 events/block   block
+//   convolution     ConvolutionEngine::process           block, rate, IR length
+//   oversampler-xN  Oversampler::process, N = 2, 4, 8    block, rate
+//   processBlock    OrchestraSynthEngine::processBlock   block, rate, voices
+//
+// processBlock and midiRouting results also carry PerformanceMonitor's
+// per-stage means ("stages", us per call) when built with stage timing.
+// They also record "activeVoices", the voices actually sounding, which is
+// lower than "voices" when the sections' voice limits cap it.
+//
+//   OrchestraSynthBenchmark [--out results.json] [--baseline baseline.json]
+//                           [--tolerance 0.10] [--filter <name>] [--quick]
+//                           [--threads N]
+//
+// With --baseline, cases are matched by name and parameters. The exit code
+// is 2 if any case got slower than baseline * (1 + tolerance).
+
+namespace
+{
+    struct BenchCase
+    {
+        juce::String name;
+        int blockSize = 512;
+        double sampleRate = 48000.0;
+        int voices = 32;
+        double irSeconds = 2.0;
+
+        juce::String getKey() const
+        {
+            return name + "|" + juce::String (blockSize) + "|" + juce::String ((int) sampleRate)
+                 + "|" + juce::String (voices) + "|" + juce::String (irSeconds, 2);
+        }
+    };
+
+    struct BenchResult
+    {
+        BenchCase benchCase;
+        double nsPerSample = 0.0;
+        double realTimeFactor = 0.0;
+        double baselineNsPerSample = 0.0; // 0 = no baseline entry
+        std::map<juce::String, double> stageMeanUs; // PerformanceMonitor stages, processBlock cases only
+        int activeVoices = -1; // voices actually sounding, processBlock cases only
+    };
+
+    struct BenchOptions
+    {
+        juce::File outputFile;
+        juce::File baselineFile;
+        double tolerance = 0.10;
+        juce::String filter;
+        double secondsPerCase = 0.5;
+        int numThreads = 0;
+    };
+
+    constexpr int referenceBlockSize = 512;
+    constexpr double referenceSampleRate = 48000.0;
+    constexpr int referenceVoices = 32;
+    constexpr double referenceIrSeconds = 2.0;
+
+    // Bump when results stop being comparable with older files.
+    constexpr int resultsSchema = 2;
+
+    const int blockSizes[]       = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    const double sampleRates[]   = { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    const int voiceCounts[]      = { 1, 8, 16, 32, 64, 128, 176 };
+    const double irLengths[]     = { 0.25, 1.0, 2.0, 4.0, 8.0 };
+
+    // Runs processOneBlock repeatedly and returns the median ns per block.
+    double measureNsPerBlock (const std::function<void()>& processOneBlock, double secondsPerCase)
+    {
+        constexpr int numRuns = 5;
+
+        for (int i = 0; i < 16; ++i)
+            processOneBlock();
+
+        const auto ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+        const auto ticksPerRun = (juce::int64) (ticksPerSecond * secondsPerCase / numRuns);
+
+        std::vector<double> runs;
+        for (int r = 0; r < numRuns; ++r)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            auto now = start;
+            juce::int64 blocks = 0;
+
+            do
+            {
+                processOneBlock();
+                ++blocks;
+                now = juce::Time::getHighResolutionTicks();
+            }
+            while (now - start < ticksPerRun);
+
+            runs.push_back ((double) (now - start) * 1.0e9 / ticksPerSecond / (double) blocks);
+        }
+
+        std::sort (runs.begin(), runs.end());
+        return runs[(size_t) numRuns / 2];
+    }
+
+    void fillNoise (juce::AudioBuffer<float>& buffer, juce::Random& random)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            auto* d = buffer.getWritePointer (ch);
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                d[i] = random.nextFloat() * 0.5f - 0.25f;
+        }
+    }
+
+    // ---------------------------------------------------------------------
+
+    double benchVoiceBank (const BenchCase& c, double seconds, bool modulateFilter)
+    {
+        WavetableBank wavetables;
+        wavetables.prepare (c.sampleRate);
+
+        SectionVoiceBank bank;
+        bank.prepare (c.sampleRate, c.voices, wavetables);
+        bank.setFilterSlot (0, 8000.0f, 0.7f);
+        bank.setEnvelopeSlot (0, 0.01f, 0.05f, 0.8f, 600.0f); // retriggered duplicates keep sounding
+
+        SectionVoiceBank::NoteSetup setup;
+
+        for (int v = 0; v < c.voices; ++v)
+            bank.noteOn (24 + v % 88, setup);
+
+        std::vector<float> mono ((size_t) c.blockSize);
+        bool high = false;
+
+        return measureNsPerBlock ([&]
+        {
+            if (modulateFilter)
+            {
+                high = ! high;
+                bank.setFilterModulation (high ? 12000.0f : 2000.0f, high ? 1.4f : 0.8f);
+            }
+
+            std::fill (mono.begin(), mono.end(), 0.0f);
+            bank.render (mono.data(), c.blockSize);
+        }, seconds);
+    }
+
+    double benchConvolution (const BenchCase& c, double seconds)
+    {
+        Logger logger;
+        ConvolutionEngine reverb (logger);
+        reverb.setNonRealtime (true); // include the background tail work, as before
+
+        juce::dsp::ProcessSpec spec { c.sampleRate, (juce::uint32) c.blockSize, 2 };
+        reverb.prepare (spec);
+
+        juce::Random random (1234);
+        juce::AudioBuffer<float> ir (2, juce::jmax (1, (int) (c.irSeconds * c.sampleRate)));
+        fillNoise (ir, random);
+        for (int ch = 0; ch < 2; ++ch)
+            ir.applyGainRamp (ch, 0, ir.getNumSamples(), 1.0f, 0.0f);
+
+        reverb.loadImpulseResponse (std::move (ir), c.sampleRate);
+
+        juce::AudioBuffer<float> input (2, c.blockSize), buffer (2, c.blockSize);
+        fillNoise (input, random);
+
+        // The IR is prepared on a background thread and adopted during process()
+        for (int i = 0; i < 1000 && ! reverb.hasImpulseResponse(); ++i)
+        {
+            buffer.makeCopyOf (input, true);
+            reverb.process (buffer);
+            juce::Thread::sleep (5);
+        }
+
+        return measureNsPerBlock ([&]
+        {
+            buffer.makeCopyOf (input, true);
+            reverb.process (buffer);
+        }, seconds);
+    }
+
+    // Up/down filtering only: the render callback copies precomputed noise.
+    double benchOversampler (const BenchCase& c, double seconds, int factor)
+    {
+        Oversampler oversampler;
+        oversampler.prepare (c.blockSize);
+        oversampler.setFactor (factor);
+
+        juce::Random random (99);
+        juce::AudioBuffer<float> noise (1, c.blockSize * factor);
+        fillNoise (noise, random);
+
+        juce::AudioBuffer<float> buffer (1, c.blockSize);
+
+        return measureNsPerBlock ([&]
+        {
+            buffer.clear();
+            oversampler.process (buffer.getWritePointer (0), c.blockSize, [&] (float* up, int n)
+            {
+                juce::FloatVectorOperations::copy (up, noise.getReadPointer (0), n);
+            });
+        }, seconds);
+    }
+
+    // Starts numVoices held notes, spread round-robin over the sections up to each section's voice limit.
+    // Notes start above the articulation keyswitches, which would otherwise be swallowed.
+    void startEngineNotes (OrchestraSynthEngine& engine, int numVoices, juce::MidiBuffer& midi)
+    {
+        constexpr int firstKey = OrchestraSynthEngine::articulationKeyswitchBaseNote + OrchestraSynthEngine::numArticulations;
+        constexpr int numKeys = 112 - firstKey; // up to E7
+        std::array<int, OrchestraSynthEngine::numSections> limit {}, used {};
+
+        for (int sec = 0; sec < OrchestraSynthEngine::numSections; ++sec)
+            limit[(size_t) sec] = juce::jmin (numKeys, engine.getSectionSnapshot ((OrchestraSynthEngine::SectionIndex) sec).params.maxVoices);
+
+        for (int started = 0; started < numVoices;)
+        {
+            const auto before = started;
+
+            for (int sec = 0; sec < OrchestraSynthEngine::numSections && started < numVoices; ++sec)
+            {
+                if (used[(size_t) sec] >= limit[(size_t) sec])
+                    continue;
+
+                midi.addEvent (juce::MidiMessage::noteOn (sec + 1, firstKey + used[(size_t) sec], (juce::uint8) 100), 0);
+                ++used[(size_t) sec];
+                ++started;
+            }
+
+            if (started == before)
+                break; // every section is full
+        }
+    }
+
+    // Mean time per call of every stage that ran, e.g. "reverb", "section0.voices".
+    std::map<juce::String, double> collectStageTimes (const PerformanceMonitor& perfMon)
+    {
+        std::map<juce::String, double> stages;
+
+        for (int i = 0; i < PerformanceMonitor::numStages; ++i)
+        {
+            const auto stage = (PerformanceMonitor::Stage) i;
+            const auto s = perfMon.getStageSnapshot (stage);
+            if (s.calls > 0)
+                stages[PerformanceMonitor::getStageName (stage)] = s.meanUs;
+        }
+
+        for (int sec = 0; sec < OrchestraSynthEngine::numSections; ++sec)
+        {
+            for (int i = 0; i < PerformanceMonitor::numSectionStages; ++i)
+            {
+                const auto stage = (PerformanceMonitor::SectionStage) i;
+                const auto s = perfMon.getSectionStageSnapshot (sec, stage);
+                if (s.calls > 0)
+                    stages["section" + juce::String (sec) + "." + PerformanceMonitor::getSectionStageName (stage)] = s.meanUs;
+            }
+        }
+
+        return stages;
+    }
+
+    double benchProcessBlock (const BenchCase& c, double seconds, int numThreads, bool denseMidi,
+                              std::map<juce::String, double>& stageMeanUs, int& activeVoices)
+    {
+        Logger logger;
+        PerformanceMonitor perfMon (logger);
+        PresetManager presetManager;
+        OrchestraSynthEngine engine (presetManager, perfMon, logger);
+
+        engine.setParallelRenderingEnabled (numThreads > 1, numThreads - 1);
+        engine.setNonRealtime (true);
+        engine.prepare (c.sampleRate, c.blockSize);
+
+        juce::AudioBuffer<float> buffer (2, c.blockSize);
+        juce::MidiBuffer midi;
+
+        if (! denseMidi)
+        {
+            startEngineNotes (engine, c.voices, midi);
+            engine.processBlock (buffer, midi);
+        }
+
+        activeVoices = 0;
+        for (int sec = 0; sec < OrchestraSynthEngine::numSections; ++sec)
+            activeVoices += engine.getSectionSnapshot ((OrchestraSynthEngine::SectionIndex) sec).activeVoices;
+
+        perfMon.beginSession();
+
+        const auto result = measureNsPerBlock ([&]
+        {
+            midi.clear();
+
+            if (denseMidi)
+            {
+                // Note-offs for notes that are not playing: routing cost only
+                for (int i = 0; i < 256; ++i)
+                    midi.addEvent (juce::MidiMessage::noteOff (i % OrchestraSynthEngine::numSections + 1, 100),
+                                   (i * c.blockSize) / 256);
+            }
+
+            engine.processBlock (buffer, midi);
+        }, seconds);
+
+        stageMeanUs = collectStageTimes (perfMon);
+        engine.setParallelRenderingEnabled (false);
+        return result;
+    }
+
+    // ---------------------------------------------------------------------
+
+    std::vector<BenchCase> buildCases (const juce::String& filter)
+    {
+        std::vector<BenchCase> cases;
+        std::set<juce::String> seen;
+
+        auto add = [&] (BenchCase c)
+        {
+            if (filter.isNotEmpty() && ! c.name.containsIgnoreCase (filter))
+                return;
+
+            if (seen.insert (c.getKey()).second)
+                cases.push_back (c);
+        };
+
+        auto sweep = [&] (const char* name, bool blocks, bool rates, bool voices, bool irs)
+        {
+            BenchCase ref { name, referenceBlockSize, referenceSampleRate, referenceVoices, referenceIrSeconds };
+            add (ref);
+
+            if (blocks) for (auto v : blockSizes)  { auto c = ref; c.blockSize = v;  add (c); }
+            if (rates)  for (auto v : sampleRates) { auto c = ref; c.sampleRate = v; add (c); }
+            if (voices) for (auto v : voiceCounts) { auto c = ref; c.voices = v;     add (c); }
+            if (irs)    for (auto v : irLengths)   { auto c = ref; c.irSeconds = v;  add (c); }
+        };
+
+        sweep ("voiceBank",    true, true,  true,  false);
+        sweep ("voiceFilter",  true, false, true,  false);
+        sweep ("midiRouting",  true, false, false, false);
+        sweep ("convolution",  true, true,  false, true);
+        sweep ("oversampler-x2", true, true, false, false);
+        sweep ("oversampler-x4", true, true, false, false);
+        sweep ("oversampler-x8", true, true, false, false);
+        sweep ("processBlock", true, true,  true,  false);
+
+        return cases;
+    }
+
+    BenchResult runCase (const BenchCase& c, const BenchOptions& options)
+    {
+        double nsPerBlock = 0.0;
+        const auto seconds = options.secondsPerCase;
+        BenchResult r;
+
+        if      (c.name == "voiceBank")    nsPerBlock = benchVoiceBank (c, seconds, false);
+        else if (c.name == "voiceFilter")  nsPerBlock = benchVoiceBank (c, seconds, true);
+        else if (c.name == "midiRouting")  nsPerBlock = benchProcessBlock (c, seconds, options.numThreads, true, r.stageMeanUs, r.activeVoices);
+        else if (c.name == "convolution")  nsPerBlock = benchConvolution (c, seconds);
+        else if (c.name.startsWith ("oversampler")) nsPerBlock = benchOversampler (c, seconds, c.name.getTrailingIntValue());
+        else if (c.name == "processBlock") nsPerBlock = benchProcessBlock (c, seconds, options.numThreads, false, r.stageMeanUs, r.activeVoices);
+
+        r.benchCase = c;
+        r.nsPerSample = nsPerBlock / (double) c.blockSize;
+
+        const auto blockSeconds = (double) c.blockSize / c.sampleRate;
+        r.realTimeFactor = nsPerBlock > 0.0 ? blockSeconds / (nsPerBlock * 1.0e-9) : 0.0;
+        return r;
+    }
+
+    // ---------------------------------------------------------------------
+
+    juce::var resultsToJson (const std::vector<BenchResult>& results, const BenchOptions& options)
+    {
+        juce::Array<juce::var> entries;
+
+        for (const auto& r : results)
+        {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty ("name",           r.benchCase.name);
+            entry->setProperty ("key",            r.benchCase.getKey());
+            entry->setProperty ("blockSize",      r.benchCase.blockSize);
+            entry->setProperty ("sampleRate",     r.benchCase.sampleRate);
+            entry->setProperty ("voices",         r.benchCase.voices);
+            entry->setProperty ("irSeconds",      r.benchCase.irSeconds);
+
+            if (r.activeVoices >= 0)
+                entry->setProperty ("activeVoices", r.activeVoices);
+
+            entry->setProperty ("nsPerSample",    r.nsPerSample);
+            entry->setProperty ("realTimeFactor", r.realTimeFactor);
+
+            if (r.baselineNsPerSample > 0.0)
+            {
+                entry->setProperty ("baselineNsPerSample", r.baselineNsPerSample);
+                entry->setProperty ("change", r.nsPerSample / r.baselineNsPerSample - 1.0);
+            }
+
+            if (! r.stageMeanUs.empty())
+            {
+                auto* stages = new juce::DynamicObject();
+                for (const auto& [name, us] : r.stageMeanUs)
+                    stages->setProperty (juce::Identifier (name), us);
+
+                entry->setProperty ("stages", juce::var (stages));
+            }
+
+            entries.add (juce::var (entry));
+        }
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty ("schema", resultsSchema);
+        root->setProperty ("version", ProjectInfo::versionString);
+        root->setProperty ("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty ("numCpus", juce::SystemStats::getNumCpus());
+        root->setProperty ("threads", options.numThreads);
+        root->setProperty ("secondsPerCase", options.secondsPerCase);
+        root->setProperty ("results", entries);
+        return juce::var (root);
+    }
+
+    // Returns the number of regressions beyond the tolerance.
+    int compareWithBaseline (std::vector<BenchResult>& results, const BenchOptions& options)
+    {
+        const auto baseline = juce::JSON::parse (options.baselineFile);
+        const auto* entries = baseline.getProperty ("results", {}).getArray();
+
+        if (entries == nullptr)
+        {
+            std::cerr << "Baseline has no results: " << options.baselineFile.getFullPathName() << "\n";
+            return 0;
+        }
+
+        if ((int) baseline.getProperty ("schema", 0) != resultsSchema)
+        {
+            std::cerr << "Baseline schema doesn't match (expected " << resultsSchema << "), not comparing: "
+                      << options.baselineFile.getFullPathName() << "\n";
+            return 0;
+        }
+
+        std::map<juce::String, double> baselineByKey;
+        for (const auto& e : *entries)
+            baselineByKey[e.getProperty ("key", {}).toString()] = (double) e.getProperty ("nsPerSample", 0.0);
+
+        int regressions = 0;
+
+        for (auto& r : results)
+        {
+            const auto it = baselineByKey.find (r.benchCase.getKey());
+            if (it == baselineByKey.end() || it->second <= 0.0)
+                continue;
+
+            r.baselineNsPerSample = it->second;
+            const auto change = r.nsPerSample / it->second - 1.0;
+
+            if (change > options.tolerance)
+            {
+                ++regressions;
+                std::cerr << "REGRESSION  " << r.benchCase.getKey() << "  "
+                          << juce::String (it->second, 3) << " -> " << juce::String (r.nsPerSample, 3)
+                          << " ns/sample (+" << juce::String (change * 100.0, 1) << "%)\n";
+            }
+            else if (change < -options.tolerance)
+            {
+                std::cerr << "improved    " << r.benchCase.getKey() << "  "
+                          << juce::String (change * 100.0, 1) << "%\n";
+            }
+        }
+
+        return regressions;
+    }
+
+    bool parseOptions (const juce::ArgumentList& args, BenchOptions& options)
+    {
+        const auto cwd = juce::File::getCurrentWorkingDirectory();
+
+        if (args.containsOption ("--out"))
+            options.outputFile = cwd.getChildFile (args.getValueForOption ("--out"));
+
+        if (args.containsOption ("--baseline"))
+        {
+            options.baselineFile = cwd.getChildFile (args.getValueForOption ("--baseline"));
+            if (! options.baselineFile.existsAsFile())
+            {
+                std::cerr << "Baseline not found: " << options.baselineFile.getFullPathName() << "\n";
+                return false;
+            }
+        }
+
+        if (args.containsOption ("--tolerance"))
+            options.tolerance = juce::jlimit (0.0, 10.0, args.getValueForOption ("--tolerance").getDoubleValue());
+
+        if (args.containsOption ("--filter"))
+            options.filter = args.getValueForOption ("--filter");
+
+        if (args.containsOption ("--quick"))
+            options.secondsPerCase = 0.1;
+
+        if (args.containsOption ("--threads"))
+            options.numThreads = juce::jlimit (0, (int) OrchestraSynthEngine::numSections,
+                                               args.getValueForOption ("--threads").getIntValue());
+
+        return true;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    const juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        std::cout << "Usage: OrchestraSynthBenchmark [--out results.json] [--baseline baseline.json]\n"
+                     "                               [--tolerance 0.10] [--filter <name>] [--quick]\n"
+                     "                               [--threads N]\n";
+        return 0;
+    }
+
+    BenchOptions options;
+    if (! parseOptions (args, options))
+        return 1;
+
+    std::vector<BenchResult> results;
+
+    for (const auto& c : buildCases (options.filter))
+    {
+        results.push_back (runCase (c, options));
+        const auto& r = results.back();
+
+        std::cerr << r.benchCase.getKey().paddedRight (' ', 36) << "  "
+                  << juce::String (r.nsPerSample, 3).paddedLeft (' ', 10) << " ns/sample  "
+                  << juce::String (r.realTimeFactor, 1).paddedLeft (' ', 9) << "x RT";
+
+        if (r.activeVoices >= 0 && r.activeVoices != r.benchCase.voices && r.benchCase.name == "processBlock")
+            std::cerr << "  (" << r.activeVoices << " voices sounding)";
+
+        std::cerr << "\n";
+    }
+
+    const auto regressions = options.baselineFile != juce::File() ? compareWithBaseline (results, options) : 0;
+    const auto json = juce::JSON::toString (resultsToJson (results, options));
+
+    if (options.outputFile != juce::File())
+    {
+        if (! options.outputFile.replaceWithText (json))
+        {
+            std::cerr << "Could not write " << options.outputFile.getFullPathName() << "\n";
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout << json << "\n";
+    }
+
+    if (regressions > 0)
+    {
+        std::cerr << regressions << " case(s) slower than baseline by more than "
+                  << juce::String (options.tolerance * 100.0, 0) << "%\n";
+        return 2;
+    }
+
+    return 0;
+}
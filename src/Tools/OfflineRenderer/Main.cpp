@@ -0,0 +1,301 @@
+#include <JuceHeader.h>
+
+#include "../../Engine/OrchestraSynthEngine.h"
+#include "../../Systems/Logger.h"
+#include "../../Systems/PerformanceMonitor.h"
+#include "../../Systems/PresetManager.h"
+
+#include <iostream>
+
+// Headless bounce: Standard MIDI File (+ optional preset) -> WAV/FLAC.
+//
+// Drives OrchestraSynthEngine::prepare/processBlock directly, as fast as
+// the machine allows, with no audio device or host involved.
+//
+//   OrchestraSynthRender --midi song.mid --out song.wav
+//                        [--preset state.xml] [--sample-rate 48000]
+//                        [--block 512] [--bits 24] [--tail 3.0]   (bits: 16, 24, 32; FLAC 16, 24)
+//                        [--threads N]   (0 = serial, default = all cores)
+//                        [--trace trace.json]  (Chrome/Perfetto trace of the bounce)
+//                        [--counters]          (Linux: audio-thread IPC and misses per voice-sample;
+//                                               use --threads 0 to count all section rendering)
+
+namespace
+{
+    struct RenderOptions
+    {
+        juce::File midiFile;
+        juce::File outputFile;
+        juce::File presetFile;
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int bitDepth = 24;
+        double tailSeconds = 3.0;
+        int numThreads = -1;
+        juce::File traceFile;
+        bool hardwareCounters = false;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: OrchestraSynthRender --midi <file.mid> --out <file.wav|file.flac>\n"
+                     "                            [--preset <state.xml|state.bin>] [--sample-rate <Hz>]\n"
+                     "                            [--block <samples>] [--bits <16|24|32> (FLAC: 16|24)] [--tail <seconds>]\n"
+                     "                            [--threads <N>] [--trace <trace.json>] [--counters]\n";
+    }
+
+    juce::String getOption (const juce::ArgumentList& args, const char* name)
+    {
+        return args.containsOption (name) ? args.getValueForOption (name) : juce::String();
+    }
+
+    bool parseOptions (const juce::ArgumentList& args, RenderOptions& options)
+    {
+        const auto midi = getOption (args, "--midi");
+        const auto out  = getOption (args, "--out");
+
+        if (midi.isEmpty() || out.isEmpty())
+            return false;
+
+        options.midiFile   = juce::File::getCurrentWorkingDirectory().getChildFile (midi);
+        options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile (out);
+
+        if (const auto preset = getOption (args, "--preset"); preset.isNotEmpty())
+            options.presetFile = juce::File::getCurrentWorkingDirectory().getChildFile (preset);
+
+        if (const auto trace = getOption (args, "--trace"); trace.isNotEmpty())
+            options.traceFile = juce::File::getCurrentWorkingDirectory().getChildFile (trace);
+
+        options.hardwareCounters = args.containsOption ("--counters");
+
+        if (const auto v = getOption (args, "--sample-rate"); v.isNotEmpty())
+            options.sampleRate = juce::jlimit (8000.0, 384000.0, v.getDoubleValue());
+
+        if (const auto v = getOption (args, "--block"); v.isNotEmpty())
+            options.blockSize = juce::jlimit (16, 8192, v.getIntValue());
+
+        if (const auto v = getOption (args, "--bits"); v.isNotEmpty())
+            options.bitDepth = v.getIntValue();
+
+        const auto isFlac = options.outputFile.hasFileExtension ("flac");
+        if (options.bitDepth != 16 && options.bitDepth != 24 && (isFlac || options.bitDepth != 32))
+        {
+            std::cerr << "Unsupported --bits " << options.bitDepth << " for " << (isFlac ? "FLAC" : "WAV")
+                      << " (use " << (isFlac ? "16 or 24" : "16, 24 or 32") << ")\n";
+            return false;
+        }
+
+        if (const auto v = getOption (args, "--tail"); v.isNotEmpty())
+            options.tailSeconds = juce::jmax (0.0, v.getDoubleValue());
+
+        if (const auto v = getOption (args, "--threads"); v.isNotEmpty())
+            options.numThreads = juce::jmax (0, v.getIntValue());
+
+        return true;
+    }
+
+    // Accepts the plugin's binary state, or XML whose root is (or contains) "sections".
+    bool loadPreset (const juce::File& file, OrchestraSynthEngine& engine)
+    {
+        juce::ValueTree root;
+
+        if (auto xml = juce::XmlDocument::parse (file))
+        {
+            root = juce::ValueTree::fromXml (*xml);
+        }
+        else
+        {
+            juce::MemoryBlock data;
+            if (file.loadFileAsData (data))
+                root = juce::ValueTree::readFromData (data.getData(), data.getSize());
+        }
+
+        if (! root.isValid())
+            return false;
+
+        const auto sections = root.hasType (juce::Identifier ("sections"))
+                                ? root
+                                : root.getChildWithName (juce::Identifier ("sections"));
+        if (! sections.isValid())
+            return false;
+
+        engine.deserialiseFromValueTree (sections);
+        return true;
+    }
+
+    // All tracks merged onto one timeline, timestamps in seconds.
+    bool loadMidiSequence (const juce::File& file, juce::MidiMessageSequence& sequence)
+    {
+        juce::FileInputStream in (file);
+        juce::MidiFile midiFile;
+
+        if (! in.openedOk() || ! midiFile.readFrom (in))
+            return false;
+
+        midiFile.convertTimestampTicksToSeconds();
+
+        for (int t = 0; t < midiFile.getNumTracks(); ++t)
+            sequence.addSequence (*midiFile.getTrack (t), 0.0);
+
+        sequence.updateMatchedPairs();
+        return true;
+    }
+
+    std::unique_ptr<juce::AudioFormatWriter> createWriter (const RenderOptions& options)
+    {
+        std::unique_ptr<juce::AudioFormat> format;
+
+        if (options.outputFile.hasFileExtension ("flac"))
+            format = std::make_unique<juce::FlacAudioFormat>();
+        else
+            format = std::make_unique<juce::WavAudioFormat>();
+
+        options.outputFile.deleteFile();
+        auto stream = options.outputFile.createOutputStream();
+        if (stream == nullptr)
+            return nullptr;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(),
+                                                                                  options.sampleRate,
+                                                                                  2,
+                                                                                  options.bitDepth,
+                                                                                  {},
+                                                                                  0));
+        if (writer != nullptr)
+            stream.release(); // now owned by the writer
+
+        return writer;
+    }
+
+    int runRender (const RenderOptions& options)
+    {
+        Logger logger;
+        PerformanceMonitor perfMon (logger);
+        PresetManager presetManager;
+        OrchestraSynthEngine engine (presetManager, perfMon, logger);
+
+        juce::MidiMessageSequence sequence;
+        if (! loadMidiSequence (options.midiFile, sequence))
+        {
+            std::cerr << "Could not read MIDI file: " << options.midiFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        if (options.presetFile != juce::File() && ! loadPreset (options.presetFile, engine))
+        {
+            std::cerr << "Could not read preset: " << options.presetFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        auto writer = createWriter (options);
+        if (writer == nullptr)
+        {
+            std::cerr << "Could not create output file: " << options.outputFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        // One job per section, so more than numSections threads would only idle
+        const auto numThreads = juce::jmin ((int) OrchestraSynthEngine::numSections,
+                                            options.numThreads < 0 ? juce::SystemStats::getNumCpus()
+                                                                   : options.numThreads);
+        engine.setParallelRenderingEnabled (numThreads > 1, numThreads - 1);
+        engine.setNonRealtime (true);
+        engine.prepare (options.sampleRate, options.blockSize);
+
+        const auto songSeconds = sequence.getNumEvents() > 0 ? sequence.getEndTime() : 0.0;
+        const auto outputSamples = (juce::int64) std::ceil ((songSeconds + options.tailSeconds) * options.sampleRate);
+
+        // Oversampled sections delay the whole mix: render that much longer and
+        // drop the leading samples, so the file lines up with the MIDI.
+        const auto latency = (juce::int64) engine.getLatencySamples();
+        const auto totalSamples = outputSamples + latency;
+
+        juce::AudioBuffer<float> buffer (2, options.blockSize);
+        juce::MidiBuffer midi;
+
+        int nextEvent = 0;
+        perfMon.setHardwareCountersEnabled (options.hardwareCounters);
+        perfMon.beginSession (options.traceFile);
+        const auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+        for (juce::int64 blockStart = 0; blockStart < totalSamples; blockStart += options.blockSize)
+        {
+            const auto numSamples = (int) juce::jmin ((juce::int64) options.blockSize, totalSamples - blockStart);
+            const auto blockEnd = blockStart + numSamples;
+
+            midi.clear();
+            while (nextEvent < sequence.getNumEvents())
+            {
+                const auto& message = sequence.getEventPointer (nextEvent)->message;
+                const auto samplePos = (juce::int64) std::llround (message.getTimeStamp() * options.sampleRate);
+                if (samplePos >= blockEnd)
+                    break;
+
+                if (! message.isMetaEvent())
+                    midi.addEvent (message, (int) juce::jmax ((juce::int64) 0, samplePos - blockStart));
+
+                ++nextEvent;
+            }
+
+            buffer.setSize (2, numSamples, false, false, true);
+            engine.processBlock (buffer, midi);
+
+            const auto skip = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numSamples, latency - blockStart);
+            if (skip < numSamples && ! writer->writeFromAudioSampleBuffer (buffer, skip, numSamples - skip))
+            {
+                std::cerr << "Write failed: " << options.outputFile.getFullPathName() << "\n";
+                return 1;
+            }
+        }
+
+        writer.reset(); // flush before reporting
+        engine.setParallelRenderingEnabled (false);
+        perfMon.endSession(); // writes the trace, if any
+
+        const auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+        const auto renderedSeconds = (double) outputSamples / options.sampleRate;
+        const auto realTimeFactor = elapsedSeconds > 0.0 ? renderedSeconds / elapsedSeconds : 0.0;
+
+        std::cout << "Rendered " << juce::String (renderedSeconds, 2) << " s of audio in "
+                  << juce::String (elapsedSeconds, 2) << " s ("
+                  << juce::String (realTimeFactor, 1) << "x real time, "
+                  << numThreads << " thread(s)) -> "
+                  << options.outputFile.getFullPathName() << "\n";
+
+        if (options.traceFile != juce::File())
+            std::cout << "Trace -> " << options.traceFile.getFullPathName() << "\n";
+
+        if (options.hardwareCounters)
+        {
+            const auto hw = perfMon.getHardwareCounterSnapshot();
+
+            if (hw.available && hw.blocks > 0)
+                std::cout << "Audio thread: IPC " << juce::String (hw.ipc, 2)
+                          << ", per voice-sample: " << juce::String (hw.cyclesPerVoiceSample, 1) << " cycles, "
+                          << juce::String (hw.l1dMissesPerVoiceSample, 3) << " L1D misses, "
+                          << juce::String (hw.llcMissesPerVoiceSample, 4) << " LLC misses, "
+                          << juce::String (hw.branchMissesPerVoiceSample, 3) << " branch misses\n";
+            else
+                std::cout << "Hardware counters unavailable: " << hw.status << "\n";
+        }
+
+        if (const auto dropped = engine.getDroppedMidiEventCount(); dropped > 0)
+            std::cout << "Warning: " << dropped << " MIDI event(s) dropped (section queue full)\n";
+
+        return 0;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    const juce::ArgumentList args (argc, argv);
+
+    RenderOptions options;
+    if (args.containsOption ("--help|-h") || ! parseOptions (args, options))
+    {
+        printUsage();
+        return args.containsOption ("--help|-h") ? 0 : 1;
+    }
+
+    return runRender (options);
+}
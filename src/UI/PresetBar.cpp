@@ -95,8 +95,13 @@ void PresetBar::updateStatusText()
     auto stats = perfMon.getSnapshot();
     juce::String text;
     text << "Block: "
-         << juce::String (stats.lastBlockMs, 2) << " ms  (avg "
-         << juce::String (stats.averageBlockMs, 2) << " ms), "
+         << juce::String (stats.lastBlockMs, 2) << " ms  (p99 "
+         << juce::String (stats.p99BlockMs, 2) << " / max "
+         << juce::String (stats.maxBlockMs, 2) << " ms, load p99 "
+         << juce::String (stats.p99Load * 100.0, 0) << "%), "
+         << "Overruns: " << juce::String ((juce::int64) stats.overruns) << ", "
+         << "Sections " << juce::String (perfMon.getStageSnapshot (PerformanceMonitor::Stage::RenderSections).meanUs, 0)
+         << " us, Reverb " << juce::String (perfMon.getStageSnapshot (PerformanceMonitor::Stage::Reverb).meanUs, 0) << " us, "
          << "Log entries: " << logger.getTotalCount();
 
     statusLabel.setText (text, juce::dontSendNotification);
@@ -112,7 +112,7 @@ SectionStripComponent::SectionStripComponent (OrchestraSynthEngine& engineIn,
     };
     addAndMakeVisible (articulationBox);
 
-    syncUIWithEngine();
+    syncUIWithEngine (engine.getSectionSnapshot (section));
 
     startTimerHz (10); // ~100ms updates for meter + param sync
 }
@@ -255,20 +255,27 @@ void SectionStripComponent::sliderValueChanged (juce::Slider* slider)
 
 void SectionStripComponent::timerCallback()
 {
-    auto snap = engine.getSectionSnapshot (section);
+    // One consistent snapshot per tick for both the meter and the controls
+    const auto snap = engine.getSectionSnapshot (section);
     updateMeterFromSnapshot (snap);
 
     // If engine parameters were changed from elsewhere (presets),
     // keep UI in sync without fighting the user too often.
-    syncUIWithEngine();
+    syncUIWithEngine (snap);
 
     repaint();
 }
 
-void SectionStripComponent::syncUIWithEngine()
+void SectionStripComponent::syncUIWithEngine (const OrchestraSynthEngine::SectionStateSnapshot& s)
 {
-    auto s = engine.getSectionSnapshot (section);
     const auto& p = s.params;
+    updateVoiceLabel (s);
+
+    // Nothing to push into the controls unless the params were stored again
+    if (s.paramsVersion == lastParamsVersion)
+        return;
+
+    lastParamsVersion = s.paramsVersion;
 
     auto setIfDifferent = [] (juce::Slider& slider, double v)
     {
@@ -289,7 +296,11 @@ void SectionStripComponent::syncUIWithEngine()
         articulationBox.setSelectedId (artId, juce::dontSendNotification);
 
     articulationBadge.setText (articulationBox.getText(), juce::dontSendNotification);
+}
 
+void SectionStripComponent::updateVoiceLabel (const OrchestraSynthEngine::SectionStateSnapshot& s)
+{
+    const auto& p = s.params;
     const auto voices = s.activeVoices;
     if (voices != lastActiveVoices || p.maxVoices != lastVoiceCapacity)
     {
@@ -23,7 +23,8 @@ private:
     void sliderValueChanged (juce::Slider* slider) override;
     void timerCallback() override;
 
-    void syncUIWithEngine();
+    void syncUIWithEngine (const OrchestraSynthEngine::SectionStateSnapshot& s);
+    void updateVoiceLabel (const OrchestraSynthEngine::SectionStateSnapshot& s);
     void applyToEngine();
 
     void updateMeterFromSnapshot (const OrchestraSynthEngine::SectionStateSnapshot& s);
@@ -59,6 +60,7 @@ private:
     bool typingHighlight = false;
     int lastActiveVoices = 0;
     int lastVoiceCapacity = 0;
+    std::uint32_t lastParamsVersion = ~0u; // forces the first sync
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SectionStripComponent)
 };